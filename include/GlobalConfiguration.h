@@ -4,6 +4,7 @@
 #include "peripherals/TouchSlider.h"
 #include "peripherals/TouchSliderLeds.h"
 #include "usb/device_driver.h"
+#include "utils/InputPhaseLock.h"
 
 #include "hardware/i2c.h"
 
@@ -11,6 +12,19 @@ namespace Divacon::Config::Default {
 
 const usb_mode_t usb_mode = USB_MODE_SWITCH_DIVACON;
 
+// Time after USB start-of-frame at which the next input report is queued. Should leave
+// enough room for one main loop iteration before the host polls in the next frame.
+const uint16_t usb_report_send_offset_us = 500;
+
+// Default USB polling interval in milliseconds (1, 2, 4 or 8), can be changed per mode in the menu.
+const uint8_t usb_poll_interval_ms = 1;
+
+const Utils::InputPhaseLock::Config input_phase_lock_config = {
+    false, // Sample inputs right before the next report is due instead of continuously
+    100,   // Margin between end of sampling and the next USB frame in microseconds
+    false, // Measure sample-to-transfer age (printed in debug mode)
+};
+
 const Peripherals::Buttons::Config buttons_config = {
     {
         // Pin config
@@ -54,6 +68,7 @@ const Peripherals::ButtonLeds::Config button_leds_config = {
         11, // West
     },
     false, // Invert
+    250,   // Fade out time in milliseconds
 };
 
 const Peripherals::TouchSlider::Config touch_slider_config = {
@@ -85,11 +100,19 @@ const Peripherals::TouchSlider::Config touch_slider_config = {
     // },
 };
 
-const Peripherals::TouchSliderLeds::Config touch_slider_leds_config = {
-    28,    // LED Pin
-    false, // Is RGBW strip
-    true,  // Reverse LED order
-    2,     // LEDs per segment
+constexpr Peripherals::TouchSliderLeds::Config touch_slider_leds_config = {
+    {{
+        // Pin, first segment, segment count, reverse segment order
+        {28, 0, 32, false},
+    }},
+    1,               // Strip count
+    false,           // Is RGBW strip
+    2,               // LEDs per segment
+    true,            // Gamma correction
+    {255, 255, 255}, // Color calibration, lower a channel to correct the white point of the strip
+    20,              // Current per color channel in mA, 20 for WS2812B
+    400,             // Current budget for all LEDs in mA, leaves room within the 500mA USB limit
+    120,             // Animation frames per second, frames up to half an interval late aren't dropped
 
     128,                                                            // Brightness
     128,                                                            // Animation speed
@@ -101,6 +124,10 @@ const Peripherals::TouchSliderLeds::Config touch_slider_leds_config = {
     true,                                                           // Enable LED control from PDLoader (PDLoader only)
 };
 
+static_assert(touch_slider_leds_config.leds_per_segment >= 1 &&
+                  touch_slider_leds_config.leds_per_segment <= Peripherals::TouchSliderLeds::MAX_LEDS_PER_SEGMENT,
+              "LED frames are statically sized, raise TouchSliderLeds::MAX_LEDS_PER_SEGMENT for more LEDs per segment");
+
 const Peripherals::Display::Config display_config = {
     14,      // SDA Pin
     15,      // SCL Pin
@@ -19,6 +19,14 @@
 #define MBEDTLS_PK_C
 #define MBEDTLS_RSA_C
 
+// Allocate from a static arena instead of the heap, mbedtls_memory_buffer_alloc_init() has to be
+// called before anything else.
+#define MBEDTLS_MEMORY_BUFFER_ALLOC_C
+#define MBEDTLS_PLATFORM_C
+#define MBEDTLS_PLATFORM_MEMORY
+#define MBEDTLS_PLATFORM_STD_CALLOC NULL
+#define MBEDTLS_PLATFORM_STD_FREE NULL
+
 #include "mbedtls/check_config.h"
 
 #endif
@@ -4,8 +4,14 @@
 #include "usb/device_driver.h"
 #include "utils/InputState.h"
 
+#include <array>
+#include <stdint.h>
+
 namespace Divacon::Peripherals {
 
+// Drives the face button LEDs through the PWM slices of their pins, so they can be dimmed. Released buttons fade out
+// by a DMA channel per slice which writes a table of levels to the slice, paced by the wrap of an otherwise unused
+// slice. Once started, fades need no CPU time.
 class ButtonLeds {
   public:
     struct Config {
@@ -17,19 +23,49 @@ class ButtonLeds {
         } pins;
 
         bool invert;
+        uint16_t fade_ms; // Released buttons fade out over this time, 0 turns them off right away
     };
 
   private:
+    const static size_t LED_COUNT = 4;
+    const static size_t FADE_STEPS = 32;
+
+    struct Led {
+        size_t slice; // Index into m_slices
+        uint channel;
+        bool lit;
+        bool fading;
+        uint8_t fade_from;
+        uint8_t fade_position; // Fade steps played before the current table
+    };
+
+    struct Slice {
+        uint number;
+        int dma_channel;
+        uint32_t fade_length; // Entries of `fade_table` in use, the first one is written directly
+        std::array<uint32_t, FADE_STEPS + 1> fade_table;
+    };
+
     Config m_config;
     bool m_enable_pdloader_support;
+    uint8_t m_brightness;
 
     Utils::InputState::Buttons m_buttons;
     bool m_raw_mode;
 
+    std::array<Led, LED_COUNT> m_leds;
+    std::array<Slice, LED_COUNT> m_slices;
+    size_t m_slice_count;
+
+    static uint8_t getFadeLevel(const Led &led, uint32_t position);
+
+    void show(const std::array<bool, LED_COUNT> &lit, bool fade, bool force);
+
   public:
     ButtonLeds(const Config &config, bool enable_pdloader_support);
 
     void setEnablePdloaderSupport(bool do_enable);
+    void setBrightness(uint8_t brightness);
 
     void setButtons(const Utils::InputState::Buttons &buttons);
 
@@ -39,4 +75,4 @@ class ButtonLeds {
 
 } // namespace Divacon::Peripherals
 
-#endif // _PERIPHERALS_BUTTONLEDS_H_
\ No newline at end of file
+#endif // _PERIPHERALS_BUTTONLEDS_H_
@@ -2,8 +2,10 @@
 #define _PERIPHERALS_BUTTONS_H_
 
 #include "utils/InputState.h"
+#include "utils/LatencyProbes.h"
 
-#include <map>
+#include <array>
+#include <stddef.h>
 #include <stdint.h>
 
 namespace Divacon::Peripherals {
@@ -62,6 +64,7 @@ class Buttons {
         START,
         SELECT,
         HOME,
+        COUNT,
     };
 
     class Button {
@@ -72,6 +75,10 @@ class Buttons {
         uint32_t last_change;
         bool active;
 
+#if DIVACON_LATENCY_PROBES
+        uint32_t pending_since_us = 0;
+#endif
+
       public:
         Button(uint8_t pin);
 
@@ -89,8 +96,9 @@ class Buttons {
 
     Config m_config;
     SocdState m_socd_state;
-    std::map<Id, Button> m_buttons;
+    std::array<Button, static_cast<size_t>(Id::COUNT)> m_buttons; // Indexed by Id
 
+    Button &getButton(Id id) { return m_buttons[static_cast<size_t>(id)]; };
     void socdClean(Utils::InputState &input_state);
 
   public:
@@ -3,13 +3,14 @@
 
 #include "usb/device_driver.h"
 #include "utils/InputState.h"
+#include "utils/LatencyHistogram.h"
 #include "utils/Menu.h"
 
 #include <ssd1306/ssd1306.h>
 
 #include "hardware/i2c.h"
 
-#include <memory>
+#include <array>
 #include <stdint.h>
 
 namespace Divacon::Peripherals {
@@ -25,6 +26,9 @@ class Display {
     };
 
   private:
+    const static uint16_t WIDTH = 128;
+    const static uint16_t HEIGHT = 64;
+
     enum class State {
         Idle,
         Menu,
@@ -38,8 +42,11 @@ class Display {
     usb_mode_t m_usb_mode;
     uint8_t m_player_id;
     Utils::Menu::State m_menu_state;
+    Utils::LatencyHistogram::Summary m_latency;
 
     ssd1306_t m_display;
+    std::array<uint8_t, SSD1306_BUFSIZE(WIDTH, HEIGHT)> m_buffer;
+    std::array<uint16_t, SSD1306_DMA_BUFSIZE(WIDTH, HEIGHT)> m_dma_buffer;
 
     void drawIdleScreen();
     void drawMenuScreen();
@@ -52,10 +59,13 @@ class Display {
     void setUsbMode(usb_mode_t mode);
     void setPlayerId(uint8_t player_id);
     void setMenuState(const Utils::Menu::State &menu_state);
+    void setLatency(const Utils::LatencyHistogram::Summary &latency);
 
     void showIdle();
     void showMenu();
 
+    // Draws the current screen and starts sending it. Does nothing while the previous frame is still being sent, so
+    // it never blocks on the bus.
     void update();
 };
 
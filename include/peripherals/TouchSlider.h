@@ -12,7 +12,7 @@
 #include "hardware/i2c.h"
 
 #include <array>
-#include <memory>
+#include <optional>
 #include <stdint.h>
 #include <variant>
 
@@ -65,7 +65,7 @@ class TouchSlider {
 
     class TouchControllerMpr121x3 : public TouchControllerInterface {
       private:
-        std::array<std::unique_ptr<Mpr121>, 3> m_mpr121;
+        std::array<std::optional<Mpr121>, 3> m_mpr121;
 
       public:
         TouchControllerMpr121x3(const Config::Mpr121x3 &config, i2c_inst *i2c);
@@ -75,7 +75,7 @@ class TouchSlider {
 
     class TouchControllerMpr121x4 : public TouchControllerInterface {
       private:
-        std::array<std::unique_ptr<Mpr121>, 4> m_mpr121;
+        std::array<std::optional<Mpr121>, 4> m_mpr121;
 
       public:
         TouchControllerMpr121x4(const Config::Mpr121x4 &config, i2c_inst *i2c);
@@ -85,7 +85,7 @@ class TouchSlider {
 
     class TouchControllerCap1188 : public TouchControllerInterface {
       private:
-        std::array<std::unique_ptr<Cap1188>, 4> m_cap1188;
+        std::array<std::optional<Cap1188>, 4> m_cap1188;
 
       public:
         TouchControllerCap1188(const Config::Cap1188 &config, i2c_inst *i2c);
@@ -95,7 +95,7 @@ class TouchSlider {
 
     class TouchControllerIs31se5117a : public TouchControllerInterface {
       private:
-        std::array<std::unique_ptr<Is31se5117a>, 2> m_is31se5117a;
+        std::array<std::optional<Is31se5117a>, 2> m_is31se5117a;
 
       public:
         TouchControllerIs31se5117a(const Config::Is31se5117a &config, i2c_inst *i2c);
@@ -108,7 +108,11 @@ class TouchSlider {
     usb_mode_t m_mode;
     uint32_t m_touched;
 
-    std::unique_ptr<TouchControllerInterface> m_touch_controller;
+    // Storage for the configured controller, which m_touch_controller points into.
+    std::variant<std::monostate, TouchControllerMpr121x3, TouchControllerMpr121x4, TouchControllerCap1188,
+                 TouchControllerIs31se5117a>
+        m_touch_controller_storage;
+    TouchControllerInterface *m_touch_controller;
 
     void read();
 
@@ -118,7 +122,14 @@ class TouchSlider {
   public:
     TouchSlider(const Config &config, usb_mode_t mode);
 
+    void setMode(usb_mode_t mode) { m_mode = mode; };
+
+    // Reads the touch controllers, may be called from the other core than updateInputState().
+    uint32_t scan();
+
     void updateInputState(Utils::InputState &input_state);
+    // Uses a touch state scanned elsewhere instead of reading the controllers.
+    void updateInputState(Utils::InputState &input_state, uint32_t touched);
 };
 
 } // namespace Divacon::Peripherals
@@ -1,28 +1,29 @@
 #ifndef _PERIPHERALS_TOUCHSLIDERLEDS_H_
 #define _PERIPHERALS_TOUCHSLIDERLEDS_H_
 
+#include "utils/LatencyHistogram.h"
+#include "utils/LedAnimator.h"
+
 #include <algorithm>
 #include <array>
 #include <optional>
+#include <stddef.h>
 #include <stdint.h>
-#include <vector>
 
 namespace Divacon::Peripherals {
 
 class TouchSliderLeds {
   private:
-    const static size_t SEGMENT_COUNT = 32;
+    static constexpr size_t SEGMENT_COUNT = Utils::LedAnimator::SEGMENT_COUNT;
+    static constexpr uint32_t REFRESH_INTERVAL_US = 1000000; // Unchanged frames are still sent this often
+    static constexpr uint32_t MAX_CATCH_UP_FRAMES = 4;       // Animations skip ahead at most this many frames when late
 
   public:
-    struct Config {
-        struct Color {
-            bool operator==(const Color &rhs) const { return (r == rhs.r) && (g == rhs.g) && (b == rhs.b); }
-            bool operator!=(const Color &rhs) const { return !operator==(rhs); }
+    static constexpr size_t MAX_STRIPS = 4;           // One per PIO state machine
+    static constexpr size_t MAX_LEDS_PER_SEGMENT = 8; // Size of the statically allocated frames
 
-            uint8_t r;
-            uint8_t g;
-            uint8_t b;
-        };
+    struct Config {
+        using Color = Utils::LedAnimator::Color;
 
         enum class IdleMode {
             Off,
@@ -40,10 +41,23 @@ class TouchSliderLeds {
             TouchedIdle,
         };
 
-        uint8_t led_pin;
+        // Strips are driven in parallel, each shows a range of the slider segments.
+        struct Strip {
+            uint8_t pin;
+            uint8_t first_segment;
+            uint8_t segment_count;
+            bool reverse; // Starts with the last segment of the range
+        };
+
+        std::array<Strip, MAX_STRIPS> strips;
+        size_t strip_count;
         bool is_rgbw;
-        bool reverse;
-        uint16_t leds_per_segment;
+        uint16_t leds_per_segment; // 1 to MAX_LEDS_PER_SEGMENT
+        bool gamma_correction;
+        Color calibration;          // Output for full white, per channel
+        uint8_t channel_current_ma; // Drawn by one color channel of a LED at full output
+        uint16_t max_current_ma;    // Frames which would draw more are dimmed, 0 for no limit
+        uint16_t target_fps;        // Animation frames are rendered on a fixed schedule at this rate
 
         uint8_t brightness;
         uint8_t animation_speed;
@@ -56,25 +70,72 @@ class TouchSliderLeds {
         bool enable_pdloader_support;
     };
 
-    using RawFrameMessage = std::array<Config::Color, SEGMENT_COUNT>;
+    // LED data as sent by PDLoader, it is decoded straight into the output frame.
+    struct RawFrameMessage {
+        std::array<uint8_t, SEGMENT_COUNT * 3> grb; // Green, red and blue, starting with the last segment
+        uint32_t received_us;
+    };
+
+    struct FrameStats {
+        uint32_t pushed;
+        uint32_t skipped; // Unchanged frames which were neither rendered nor sent
+        uint32_t limited; // Frames dimmed to stay within the current budget
+        uint32_t dropped; // Frames missed because the update was late, animations skipped ahead instead
+        uint32_t reused;  // Frames not sent in time since the strips were still busy, the previous one stayed on
+    };
 
   private:
     Config m_config;
-    uint32_t m_touched;
 
-    std::vector<uint32_t> m_rendered_frame;
+    // Double buffered, one frame is rendered while the other one is sent by DMA.
+    std::array<std::array<uint32_t, SEGMENT_COUNT * MAX_LEDS_PER_SEGMENT>, 2> m_frames;
+    uint32_t *m_rendered_frame;
+    size_t m_led_count;
+    std::array<uint8_t, SEGMENT_COUNT> m_segment_led_count; // LEDs showing each segment, across all strips
+    bool m_frame_pending;
+
+    // Per channel tables for r, g and b which map colors to the values sent to the strip. Raw frames are limited by
+    // the brightness instead of being scaled, so their table leaves it out.
+    using OutputLut = std::array<std::array<uint8_t, 256>, 3>;
+    OutputLut m_output_lut;
+    OutputLut m_raw_output_lut;
+
+    Utils::LedAnimator m_animator;
 
-    std::array<Config::Color, SEGMENT_COUNT> m_idle_buffer;
-    std::array<Config::Color, SEGMENT_COUNT> m_touched_buffer;
+    // Skips frames which wouldn't change the output.
+    Utils::LedAnimator::Frame m_shown_frame;
+    bool m_output_lut_changed;
+    uint32_t m_since_shown_us;
+    FrameStats m_frame_stats;
 
     std::optional<Config::Color> m_player_color;
 
     bool m_raw_mode;
+    uint32_t m_raw_received_us;
+    bool m_raw_latency_pending;
+    Utils::LatencyHistogram m_raw_latency; // Receiving a raw frame until it is sent to the strips
+
+    // Animations advance by a fixed timestep per frame, independent of when update() actually runs.
+    uint32_t m_frame_interval_us;
+    bool m_pacing_started;
+    uint32_t m_next_frame_us;
+    uint32_t m_last_frame_us;
+    uint32_t m_last_update_us;
+    uint32_t m_step_remainder;
+    uint32_t m_touched;
+    bool m_touched_changed;
+    Utils::LatencyHistogram m_frame_time;   // Between paced frames
+    Utils::LatencyHistogram m_frame_jitter; // Distance of a frame from its scheduled time
+
+    void updateOutputLuts();
+    uint32_t toPixel(const Config::Color &color, const OutputLut &lut) const;
 
-    void updateIdle(uint32_t steps);
-    void updateTouched(uint32_t steps);
+    void updateIdleColor();
 
-    void render(uint32_t steps);
+    // Estimates the current drawn by the frame and dims all pixels evenly if it exceeds the budget.
+    void limitCurrent(std::array<uint32_t, SEGMENT_COUNT> &pixels);
+    // Lays out the pixels of the segments along the strips.
+    void render(const std::array<uint32_t, SEGMENT_COUNT> &pixels);
     void show();
 
   public:
@@ -92,8 +153,17 @@ class TouchSliderLeds {
     void setTouched(uint32_t touched);
     void setPlayerColor(Config::Color color);
 
-    void update();
+    // Renders the next animation frame when it is due. Touch changes are shown right away in between, without
+    // advancing the animations.
+    void update(uint32_t now_us);
     void update(const RawFrameMessage &frame);
+
+    const FrameStats &getFrameStats() const { return m_frame_stats; };
+    Utils::LatencyHistogram::Summary getRawFrameLatency() const { return m_raw_latency.getSummary(); };
+    Utils::LatencyHistogram::Summary getFrameTime() const { return m_frame_time.getSummary(); };
+    Utils::LatencyHistogram::Summary getFrameJitter() const { return m_frame_jitter.getSummary(); };
+    uint32_t getFrameInterval() const { return m_frame_interval_us; };
+    void resetFrameStats();
 };
 
 } // namespace Divacon::Peripherals
@@ -0,0 +1,21 @@
+#ifndef _USB_DESCRIPTOR_H_
+#define _USB_DESCRIPTOR_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Copies the configuration descriptor `src` to `dst` and sets bInterval of all interrupt IN
+// endpoints to `interval`. Returns the descriptor length, or 0 if `src` is malformed or does
+// not fit into `dst`.
+//
+// Only depends on the C standard library so it can be built and checked on the host.
+uint16_t usbd_desc_cfg_set_interval(uint8_t *dst, uint16_t dst_size, const uint8_t *src, uint8_t interval);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _USB_DESCRIPTOR_H_
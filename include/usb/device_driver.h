@@ -52,6 +52,18 @@ typedef struct {
     bool (*send_report)(usb_report_t report);
 } usbd_driver_t;
 
+typedef struct {
+    uint32_t frames;         // SOFs seen since last read
+    uint32_t reports;        // Reports submitted since last read
+    uint32_t skipped_frames; // Polling intervals in which no report was submitted
+    uint16_t phase_min_us;   // Report submission time after SOF
+    uint16_t phase_max_us;
+    uint16_t phase_avg_us;
+    uint16_t poll_min_us; // Report submission to transfer completion
+    uint16_t poll_max_us;
+    uint16_t poll_avg_us;
+} usbd_report_timing_t;
+
 typedef enum {
     USB_PLAYER_LED_ID,
     USB_PLAYER_LED_COLOR,
@@ -81,13 +93,23 @@ extern char *const usbd_desc_str[];
 typedef void (*usbd_player_led_cb_t)(usb_player_led_t);
 typedef void (*usbd_slider_led_cb_t)(const uint8_t *, size_t);
 typedef void (*usbd_button_led_cb_t)(usb_button_led_t);
+typedef void (*usbd_report_complete_cb_t)(void);
 
 void usbd_driver_init(usb_mode_t mode);
+void usbd_driver_switch_mode(usb_mode_t mode);
 void usbd_driver_task();
 
 usb_mode_t usbd_driver_get_mode();
 
-void usbd_driver_send_report(usb_report_t report);
+bool usbd_driver_send_report(usb_report_t report);
+void usbd_driver_report_complete();
+
+void usbd_driver_set_send_offset(uint16_t offset_us);
+void usbd_driver_set_poll_interval(uint8_t interval_ms);
+uint8_t usbd_driver_get_poll_interval();
+bool usbd_driver_get_send_deadline(uint32_t *deadline_us);
+void usbd_driver_get_report_timing(usbd_report_timing_t *timing);
+bool usbd_driver_is_polled();
 
 void usbd_driver_set_player_led_cb(usbd_player_led_cb_t cb);
 usbd_player_led_cb_t usbd_driver_get_player_led_cb();
@@ -98,6 +120,8 @@ usbd_slider_led_cb_t usbd_driver_get_slider_led_cb();
 void usbd_driver_set_button_led_cb(usbd_button_led_cb_t cb);
 usbd_button_led_cb_t usbd_driver_get_button_led_cb();
 
+void usbd_driver_set_report_complete_cb(usbd_report_complete_cb_t cb);
+
 #ifdef __cplusplus
 }
 #endif
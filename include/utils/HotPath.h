@@ -0,0 +1,17 @@
+#ifndef _UTILS_HOTPATH_H_
+#define _UTILS_HOTPATH_H_
+
+// Marks functions which run on every iteration of the input loop or every LED frame.
+// Configuring with -DDIVACON_HOT_PATH_IN_RAM=ON places them in SRAM, so they can't
+// stall on XIP cache misses.
+#ifndef DIVACON_HOT_PATH_IN_RAM
+#define DIVACON_HOT_PATH_IN_RAM 0
+#endif
+
+#if DIVACON_HOT_PATH_IN_RAM
+#define DIVACON_HOT_PATH __attribute__((section(".time_critical.divacon")))
+#else
+#define DIVACON_HOT_PATH
+#endif
+
+#endif // _UTILS_HOTPATH_H_
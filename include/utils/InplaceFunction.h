@@ -0,0 +1,45 @@
+#ifndef _UTILS_INPLACEFUNCTION_H_
+#define _UTILS_INPLACEFUNCTION_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Divacon::Utils {
+
+template <typename Signature, size_t Capacity> class InplaceFunction;
+
+// Replacement for std::function which stores the callable inline instead of on the heap.
+// Only trivially copyable callables are supported, like lambdas capturing by reference.
+template <typename Result, typename... Args, size_t Capacity> class InplaceFunction<Result(Args...), Capacity> {
+  private:
+    using Invoker = Result (*)(const void *callable, Args... args);
+
+    alignas(std::max_align_t) unsigned char m_storage[Capacity];
+    Invoker m_invoker;
+
+  public:
+    InplaceFunction() : m_storage(), m_invoker(nullptr) {}
+
+    template <typename Callable,
+              typename = std::enable_if_t<!std::is_same_v<std::decay_t<Callable>, InplaceFunction>>>
+    InplaceFunction(Callable callable) : m_storage() {
+        static_assert(sizeof(Callable) <= Capacity, "Callable too large for InplaceFunction");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t), "Callable overaligned for InplaceFunction");
+        static_assert(std::is_trivially_copyable_v<Callable>, "Callable needs to be trivially copyable");
+
+        new (m_storage) Callable(callable);
+        m_invoker = [](const void *stored, Args... args) -> Result {
+            return (*std::launder(static_cast<const Callable *>(stored)))(std::forward<Args>(args)...);
+        };
+    }
+
+    explicit operator bool() const { return m_invoker != nullptr; }
+
+    Result operator()(Args... args) const { return m_invoker(m_storage, std::forward<Args>(args)...); }
+};
+
+} // namespace Divacon::Utils
+
+#endif // _UTILS_INPLACEFUNCTION_H_
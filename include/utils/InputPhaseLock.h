@@ -0,0 +1,47 @@
+#ifndef _UTILS_INPUTPHASELOCK_H_
+#define _UTILS_INPUTPHASELOCK_H_
+
+#include "utils/LatencyHistogram.h"
+
+#include <stdint.h>
+
+namespace Divacon::Utils {
+
+// Delays input sampling so it completes shortly before the host picks up
+// the next report, keeping the age of the reported input state minimal.
+class InputPhaseLock {
+  public:
+    struct Config {
+        bool enabled;
+        uint16_t margin_us;
+        bool measure_age;
+    };
+
+  private:
+    Config m_config;
+
+    uint32_t m_scan_estimate_us;
+    uint32_t m_sample_start_us;
+    uint32_t m_submitted_sample_us;
+    bool m_awaiting_completion;
+
+    LatencyHistogram m_age_histogram;
+
+  public:
+    InputPhaseLock(const Config &config);
+
+    void waitForSampleWindow();
+    void beginSample();
+    void endSample();
+
+    void reportSubmitted();
+    void reportCompleted();
+
+    bool enabled() const { return m_config.enabled; };
+    uint32_t getScanEstimate() const { return m_scan_estimate_us; };
+    LatencyHistogram::Summary getAgeSummary();
+};
+
+} // namespace Divacon::Utils
+
+#endif // _UTILS_INPUTPHASELOCK_H_
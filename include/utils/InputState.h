@@ -10,8 +10,8 @@
 #include "usb/device/vendor/xinput_driver.h"
 #include "usb/device_driver.h"
 
+#include <array>
 #include <stdint.h>
-#include <string>
 
 namespace Divacon::Utils {
 
@@ -26,6 +26,13 @@ struct InputState {
         bool l1, l2, l3;
         bool r1, r2, r3;
         bool start, select, home;
+
+        bool operator==(const Buttons &rhs) const {
+            return north == rhs.north && east == rhs.east && south == rhs.south && west == rhs.west && l1 == rhs.l1 &&
+                   l2 == rhs.l2 && l3 == rhs.l3 && r1 == rhs.r1 && r2 == rhs.r2 && r3 == rhs.r3 &&
+                   start == rhs.start && select == rhs.select && home == rhs.home;
+        }
+        bool operator!=(const Buttons &rhs) const { return !operator==(rhs); }
     };
 
     struct AnalogStick {
@@ -37,6 +44,9 @@ struct InputState {
     struct InputMessage {
         Buttons buttons;
         uint32_t touches;
+
+        bool operator==(const InputMessage &rhs) const { return buttons == rhs.buttons && touches == rhs.touches; }
+        bool operator!=(const InputMessage &rhs) const { return !operator==(rhs); }
     };
 
   public:
@@ -56,7 +66,7 @@ struct InputState {
     xinput_report_t m_xinput_report;
     pdloader_report_t m_pdloader_report;
     midi_report_t m_midi_report;
-    std::string m_debug_report;
+    std::array<char, 256> m_debug_report;
 
     usb_report_t getSwitchReport();
     usb_report_t getPS3InputReport();
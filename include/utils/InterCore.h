@@ -0,0 +1,328 @@
+#ifndef _UTILS_INTERCORE_H_
+#define _UTILS_INTERCORE_H_
+
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "pico/time.h"
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+// Primitives for passing data between core0 and core1. Each instance supports exactly one
+// producer and one consumer, which may live on different cores.
+//
+// Mailbox, SpscRing and Handshake are lock free. TripleBuffer swaps its indices under a
+// hardware spinlock, held for a few instructions with interrupts disabled on the calling
+// core. Every TripleBuffer claims one of the striped spinlocks, which are shared with other
+// SDK users of that pool, so an unrelated holder of the same lock can delay a swap.
+//
+// RP2040 has no data caches, so ordering only needs to be enforced with memory barriers.
+
+namespace Divacon::Utils {
+
+// Holds the latest value posted. The producer never blocks or fails, the consumer always
+// gets the most recent value. Values that were overwritten before the consumer took them
+// are counted.
+template <typename T> class Mailbox {
+  private:
+    volatile uint32_t m_sequence; // Odd while a write is in progress
+    T m_value;
+
+    // Consumer side
+    uint32_t m_taken_sequence;
+    volatile uint32_t m_overwritten;
+
+    uint32_t read(T &value) const {
+        while (true) {
+            const uint32_t sequence = m_sequence;
+            __mem_fence_acquire();
+
+            if (sequence & 1) {
+                continue;
+            }
+
+            value = m_value;
+            __mem_fence_acquire();
+
+            if (m_sequence == sequence) {
+                return sequence;
+            }
+        }
+    }
+
+  public:
+    Mailbox() : m_sequence(0), m_value({}), m_taken_sequence(0), m_overwritten(0) {}
+
+    void post(const T &value) {
+        const uint32_t sequence = m_sequence;
+
+        m_sequence = sequence + 1;
+        __mem_fence_release();
+
+        m_value = value;
+
+        __mem_fence_release();
+        m_sequence = sequence + 2;
+    }
+
+    // Returns false if there is no value newer than the last one taken.
+    bool tryTake(T &value) {
+        if (m_sequence == m_taken_sequence) {
+            return false;
+        }
+
+        const uint32_t sequence = read(value);
+        if (sequence == m_taken_sequence) {
+            return false;
+        }
+
+        m_overwritten = m_overwritten + ((sequence - m_taken_sequence) / 2) - 1;
+        m_taken_sequence = sequence;
+
+        return true;
+    }
+
+    // Reads the latest value without consuming it, returns its version.
+    uint32_t peek(T &value) const { return read(value); }
+
+    // Changes whenever a new value is posted.
+    uint32_t getVersion() const { return m_sequence; }
+    // Version of the value returned by the last successful tryTake(), consumer side only.
+    uint32_t getTakenVersion() const { return m_taken_sequence; }
+    uint32_t getOverwritten() const { return m_overwritten; }
+};
+
+// Fixed size single-producer single-consumer FIFO. Pushing to a full ring fails and
+// is counted as a drop. `Size` needs to be a power of two.
+template <typename T, size_t Size> class SpscRing {
+    static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Ring size needs to be a power of two");
+
+  private:
+    std::array<T, Size> m_items;
+    volatile uint32_t m_head; // Written by producer
+    volatile uint32_t m_tail; // Written by consumer
+    volatile uint32_t m_dropped;
+
+  public:
+    SpscRing() : m_items({}), m_head(0), m_tail(0), m_dropped(0) {}
+
+    bool tryPush(const T &item) {
+        const uint32_t head = m_head;
+        if (head - m_tail >= Size) {
+            m_dropped = m_dropped + 1;
+            return false;
+        }
+        __mem_fence_acquire(); // Slot must be released by the consumer before it is overwritten
+
+        m_items[head & (Size - 1)] = item;
+
+        __mem_fence_release();
+        m_head = head + 1;
+
+        return true;
+    }
+
+    bool tryPop(T &item) {
+        const uint32_t tail = m_tail;
+        if (m_head == tail) {
+            return false;
+        }
+        __mem_fence_acquire();
+
+        item = m_items[tail & (Size - 1)];
+
+        __mem_fence_release();
+        m_tail = tail + 1;
+
+        return true;
+    }
+
+    uint32_t getDropped() const { return m_dropped; }
+};
+
+// Passes the latest value through three buffers which are swapped instead of copied. The
+// producer fills getBack() in place and publishes it, the consumer acquires the newest
+// published buffer and reads it through getFront() until it acquires the next one.
+// Buffers published before the consumer acquired them are counted as overwritten.
+// Each instance claims a striped spinlock on construction for the swap.
+template <typename T> class TripleBuffer {
+  private:
+    const static uint8_t FRESH = 0x80; // Set while the middle buffer hasn't been acquired
+
+    std::array<T, 3> m_buffers;
+    uint8_t m_back;  // Producer side
+    uint8_t m_front; // Consumer side
+    volatile uint8_t m_middle;
+    spin_lock_t *m_lock;
+    volatile uint32_t m_overwritten;
+
+    uint8_t exchangeMiddle(uint8_t middle) {
+        const uint32_t saved_irq = spin_lock_blocking(m_lock);
+
+        const uint8_t previous = m_middle;
+        m_middle = middle;
+
+        spin_unlock(m_lock, saved_irq);
+
+        return previous;
+    }
+
+  public:
+    TripleBuffer()
+        : m_buffers({}), m_back(0), m_front(1), m_middle(2), m_lock(spin_lock_instance(next_striped_spin_lock_num())),
+          m_overwritten(0) {}
+
+    // Producer
+    T &getBack() { return m_buffers[m_back]; }
+
+    void publish() {
+        const uint8_t previous = exchangeMiddle(m_back | FRESH);
+        if (previous & FRESH) {
+            m_overwritten = m_overwritten + 1;
+        }
+        m_back = previous & ~FRESH;
+    }
+
+    // Consumer. Returns false if nothing has been published since the last call.
+    bool tryAcquire() {
+        if (!(m_middle & FRESH)) {
+            return false;
+        }
+
+        m_front = exchangeMiddle(m_front) & ~FRESH;
+        return true;
+    }
+
+    const T &getFront() const { return m_buffers[m_front]; }
+
+    uint32_t getOverwritten() const { return m_overwritten; }
+};
+
+// Request/response exchange where only the latest request matters. Responses to
+// requests which have been superseded in the meantime are discarded.
+template <typename Request, typename Response> class Handshake {
+  private:
+    struct TaggedResponse {
+        uint32_t tag;
+        Response response;
+    };
+
+    Mailbox<Request> m_request;
+    Mailbox<TaggedResponse> m_response;
+
+    // Requester side
+    uint32_t m_request_tag;
+    volatile uint32_t m_superseded;
+
+    // Responder side
+    uint32_t m_taken_tag;
+
+  public:
+    Handshake() : m_request_tag(0), m_superseded(0), m_taken_tag(0) {}
+
+    // Requester
+    void request(const Request &request) {
+        m_request.post(request);
+        m_request_tag = m_request.getVersion();
+    }
+
+    bool tryGetResponse(Response &response) {
+        TaggedResponse tagged;
+        if (!m_response.tryTake(tagged)) {
+            return false;
+        }
+
+        if (tagged.tag != m_request_tag) {
+            m_superseded = m_superseded + 1;
+            return false;
+        }
+
+        response = tagged.response;
+        return true;
+    }
+
+    // Responder
+    bool tryTakeRequest(Request &request) {
+        if (!m_request.tryTake(request)) {
+            return false;
+        }
+
+        m_taken_tag = m_request.getTakenVersion();
+        return true;
+    }
+
+    void respond(const Response &response) { m_response.post({m_taken_tag, response}); }
+
+    // Requests overwritten before being taken and responses that arrived too late.
+    uint32_t getSuperseded() const { return m_superseded + m_request.getOverwritten(); }
+};
+
+// Wakes up a consumer sleeping in wait(). Any number of rings before the consumer gets to
+// take() are folded into one, the time of the first of them is kept to measure wake latency.
+//
+// Timeouts use a hardware alarm of their own whose IRQ is enabled on the consumer core. The
+// default alarm pool of the SDK handles its IRQ on core0, so sleeping on core1 would
+// interrupt core0 on every timeout.
+class Doorbell {
+  private:
+    volatile uint32_t m_rung_us;
+    volatile bool m_pending;
+    int m_alarm; // Claimed by initConsumer()
+
+    // Taking the IRQ is enough to wake the core from WFE.
+    static void onAlarm(uint) {}
+
+  public:
+    Doorbell() : m_rung_us(0), m_pending(false), m_alarm(-1) {}
+
+    // Producer
+    void ring() {
+        if (!m_pending) {
+            m_rung_us = time_us_32();
+            __mem_fence_release();
+            m_pending = true;
+        }
+        __sev();
+    }
+
+    // Consumer, needs to be called on the consumer core before the first wait().
+    void initConsumer() {
+        m_alarm = hardware_alarm_claim_unused(true);
+        hardware_alarm_set_callback(m_alarm, onAlarm);
+    }
+
+    // Consumer. Returns false if the doorbell has not been rung since the last call.
+    bool take(uint32_t &rung_us) {
+        if (!m_pending) {
+            return false;
+        }
+        __mem_fence_acquire();
+
+        rung_us = m_rung_us;
+
+        __mem_fence_release();
+        m_pending = false;
+
+        return true;
+    }
+
+    // Sleeps in WFE until the doorbell is rung or `timeout` is reached. May return early
+    // on unrelated events, so callers need to check for work anyway.
+    void wait(absolute_time_t timeout) const {
+        if (m_pending) {
+            return;
+        }
+
+        // Returns true if the timeout has already passed.
+        if (hardware_alarm_set_target(m_alarm, timeout)) {
+            return;
+        }
+        __wfe();
+        hardware_alarm_cancel(m_alarm);
+    }
+};
+
+} // namespace Divacon::Utils
+
+#endif // _UTILS_INTERCORE_H_
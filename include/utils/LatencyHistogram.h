@@ -0,0 +1,44 @@
+#ifndef _UTILS_LATENCYHISTOGRAM_H_
+#define _UTILS_LATENCYHISTOGRAM_H_
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Divacon::Utils {
+
+class LatencyHistogram {
+  public:
+    const static size_t BUCKET_COUNT = 64;
+
+    struct Summary {
+        uint32_t count;
+        uint32_t p50_us;
+        uint32_t p90_us;
+        uint32_t p99_us;
+        uint32_t max_us;
+    };
+
+  private:
+    uint32_t m_bucket_width_us;
+    std::array<uint32_t, BUCKET_COUNT> m_buckets;
+    uint32_t m_count;
+    uint32_t m_max_us;
+
+    uint32_t percentile(uint8_t percent) const;
+
+  public:
+    LatencyHistogram(uint32_t bucket_width_us);
+
+    void add(uint32_t latency_us);
+    void reset();
+
+    uint32_t getBucketWidth() const { return m_bucket_width_us; };
+    const std::array<uint32_t, BUCKET_COUNT> &getBuckets() const { return m_buckets; };
+
+    Summary getSummary() const;
+};
+
+} // namespace Divacon::Utils
+
+#endif // _UTILS_LATENCYHISTOGRAM_H_
@@ -0,0 +1,55 @@
+#ifndef _UTILS_LATENCYPROBES_H_
+#define _UTILS_LATENCYPROBES_H_
+
+#include "utils/LatencyHistogram.h"
+
+#include <stdint.h>
+
+// Probes are compiled out unless the firmware is configured with -DDIVACON_LATENCY_PROBES=ON.
+#ifndef DIVACON_LATENCY_PROBES
+#define DIVACON_LATENCY_PROBES 0
+#endif
+
+namespace Divacon::Utils::LatencyProbes {
+
+// Timestamped points along the input path, in pipeline order.
+enum class Stage : uint8_t {
+    GpioSample,
+    TouchFrame,
+    ReportBuilt,
+    ReportSubmitted,
+    TransferComplete,
+};
+
+// Durations collected into histograms.
+enum class Span : uint8_t {
+    Debounce,    // Raw button change to debounced state change
+    TouchScan,   // GpioSample to TouchFrame
+    ReportBuild, // TouchFrame to ReportBuilt
+    Queueing,    // ReportBuilt to ReportSubmitted
+    Transfer,    // ReportSubmitted to TransferComplete
+    Total,       // GpioSample to TransferComplete
+    Count,
+};
+
+// Not thread safe, all probes need to be placed on the same core.
+void mark(Stage stage);
+void record(Span span, uint32_t duration_us);
+
+const char *getName(Span span);
+const LatencyHistogram &getHistogram(Span span);
+LatencyHistogram::Summary getSummary(Span span);
+void reset();
+
+} // namespace Divacon::Utils::LatencyProbes
+
+#if DIVACON_LATENCY_PROBES
+#define LATENCY_PROBE(stage) ::Divacon::Utils::LatencyProbes::mark(::Divacon::Utils::LatencyProbes::Stage::stage)
+#define LATENCY_PROBE_SPAN(span, duration_us)                                                                          \
+    ::Divacon::Utils::LatencyProbes::record(::Divacon::Utils::LatencyProbes::Span::span, duration_us)
+#else
+#define LATENCY_PROBE(stage) ((void)0)
+#define LATENCY_PROBE_SPAN(span, duration_us) ((void)0)
+#endif
+
+#endif // _UTILS_LATENCYPROBES_H_
@@ -0,0 +1,121 @@
+#ifndef _UTILS_LEDANIMATOR_H_
+#define _UTILS_LEDANIMATOR_H_
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Divacon::Utils {
+
+// Renders the slider LED animations. An idle and a touched layer each run an effect which is described by a table
+// entry, their output is blended into one color per segment. All state is owned by the instance and time only enters
+// through the steps passed to update(), so frames can be reproduced with a fake clock. Every frame does a fixed amount
+// of work per segment, regardless of the effects.
+class LedAnimator {
+  public:
+    const static size_t SEGMENT_COUNT = 32;
+
+    struct Color {
+        bool operator==(const Color &rhs) const { return (r == rhs.r) && (g == rhs.g) && (b == rhs.b); }
+        bool operator!=(const Color &rhs) const { return !operator==(rhs); }
+
+        uint8_t r;
+        uint8_t g;
+        uint8_t b;
+    };
+
+    using Frame = std::array<Color, SEGMENT_COUNT>;
+
+    enum class Source : uint8_t {
+        Off,
+        Color,   // The color set for the layer
+        Palette, // Scrolls over the segments
+        Idle,    // The idle layer, only for the touched layer
+    };
+
+    // Level at `time`, counted in units of `level_step_count` steps from 0 on. Levels are interpolated linearly and
+    // the last keyframe loops back to the first one.
+    struct Keyframe {
+        uint16_t time;
+        uint8_t level_percent;
+    };
+
+    // `phases` interleaved sequences of `length` colors each, advancing the position alternates between them for a
+    // smoother scroll.
+    struct Palette {
+        const Color *colors;
+        uint8_t length;
+        uint8_t phases;
+    };
+
+    struct Effect {
+        Source source;
+
+        const Keyframe *keyframes; // Optional, full level without
+        uint8_t keyframe_count;
+        uint32_t level_step_count;
+
+        const Palette *palette;
+        uint32_t palette_step_count; // 0 for a still palette
+
+        bool touched_only;         // Segments which aren't touched show no source
+        uint32_t decay_step_count; // Released segments lose a percent per this many steps, 0 clears them right away
+    };
+
+  private:
+    struct Layer {
+        const Effect *effect;
+        Color color;
+
+        uint32_t level_steps;
+        uint32_t level_position;
+
+        uint32_t palette_steps;
+        uint32_t palette_position;
+
+        uint32_t decay_steps;
+        std::array<uint8_t, SEGMENT_COUNT> decay_percent;
+
+        Frame frame;
+    };
+
+    Layer m_idle_layer;
+    Layer m_touched_layer;
+    uint32_t m_touched;
+
+    uint32_t m_blend_steps;
+    uint8_t m_blend_percent;
+
+    Frame m_frame;
+
+    static uint32_t advance(uint32_t &current_steps, uint32_t steps, uint32_t step_count);
+
+    uint8_t getLevel(Layer &layer, uint32_t steps);
+    void updateLayer(Layer &layer, uint32_t steps);
+
+  public:
+    LedAnimator(const Effect &idle_effect, const Effect &touched_effect, uint32_t seed);
+
+    // Colors are scaled by 16.16 fixed point factors, there is no FPU. Factors are rounded up, for denominators up to
+    // 255 the error stays below the smallest fraction of the ideal result, so values are exactly `value * n / d`
+    // rounded down. Decaying segments are dimmed again on every frame and would drift apart otherwise.
+    static uint32_t toScale(uint32_t numerator, uint32_t denominator);
+    static uint8_t scale(uint8_t value, uint32_t scale);
+    static Color dim(const Color &color, uint32_t scale);
+
+    void setIdleEffect(const Effect &effect);
+    void setTouchedEffect(const Effect &effect);
+    void setIdleColor(Color color) { m_idle_layer.color = color; };
+    void setTouchedColor(Color color) { m_touched_layer.color = color; };
+
+    // Segment 0 is the MSB.
+    void setTouched(uint32_t touched) { m_touched = touched; };
+
+    // Advances the animations and renders the next frame.
+    const Frame &update(uint32_t steps);
+    const Frame &getFrame() const { return m_frame; };
+};
+
+} // namespace Divacon::Utils
+
+#endif // _UTILS_LEDANIMATOR_H_
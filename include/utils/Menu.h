@@ -4,11 +4,9 @@
 #include "utils/InputState.h"
 #include "utils/SettingsStore.h"
 
-#include <map>
-#include <memory>
-#include <stack>
-#include <string>
-#include <vector>
+#include <array>
+#include <initializer_list>
+#include <stddef.h>
 
 namespace Divacon::Utils {
 
@@ -18,6 +16,7 @@ class Menu {
         Main,
 
         DeviceMode,
+        UsbPollInterval,
         Led,
         InputMirrorToDpad,
         Reset,
@@ -63,6 +62,7 @@ class Menu {
             GotoParent,
 
             GotoPageDeviceMode,
+            GotoPageUsbPollInterval,
             GotoPageLed,
             GotoPageLedBrightness,
             GotoPageLedAnimationSpeed,
@@ -85,6 +85,7 @@ class Menu {
             GotoPageLedTouchedColorBlue,
 
             SetUsbMode,
+            SetUsbPollInterval,
 
             SetLedBrightness,
             SetLedAnimationSpeed,
@@ -107,17 +108,47 @@ class Menu {
             DoRebootToBootsel,
         };
 
+        struct Item {
+            const char *name;
+            Action action;
+        };
+
+        // Fixed capacity item list, so the descriptor table can live in flash.
+        class Items {
+          public:
+            const static size_t MAX_COUNT = 11;
+
+          private:
+            std::array<Item, MAX_COUNT> m_items;
+            size_t m_count;
+
+          public:
+            constexpr Items(std::initializer_list<Item> items) : m_items({}), m_count(0) {
+                for (const auto &item : items) {
+                    m_items[m_count++] = item;
+                }
+            }
+
+            size_t size() const { return m_count; };
+            const Item &operator[](size_t idx) const { return m_items[idx]; };
+        };
+
         Type type;
-        std::string name;
-        std::vector<std::pair<std::string, Action>> items;
+        const char *name;
+        Items items;
     };
 
-    const static std::map<Page, const Descriptor> descriptors;
+    // Returns nullptr for pages without descriptor.
+    static const Descriptor *findDescriptor(Page page);
 
   private:
-    std::shared_ptr<SettingsStore> m_store;
+    // Deepest path is Main -> Led -> LedIdleColor -> LedIdleColorRed.
+    const static size_t MAX_DEPTH = 4;
+
+    SettingsStore &m_store;
     bool m_active;
-    std::stack<State> m_state_stack;
+    std::array<State, MAX_DEPTH> m_state_stack;
+    size_t m_state_depth;
 
     uint8_t getCurrentValue(Page page);
     void gotoPage(Page page);
@@ -126,7 +157,7 @@ class Menu {
     void performAction(Descriptor::Action action, uint8_t value);
 
   public:
-    Menu(std::shared_ptr<SettingsStore> settings_store);
+    Menu(SettingsStore &settings_store);
 
     void activate();
     void update(const InputState &input_state);
@@ -0,0 +1,107 @@
+#ifndef _UTILS_MODEXP_H_
+#define _UTILS_MODEXP_H_
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Divacon::Utils {
+
+// Modular exponentiation which is computed in small steps, so long running operations
+// like RSA signing can be interleaved with other work. Uses Montgomery multiplication
+// with a fixed 4 bit window. A step costs at most MULS_PER_STEP limb multiplications, or
+// RR_DOUBLINGS_PER_STEP doublings while R^2 is set up.
+//
+// Meant for private keys: table lookups and reductions don't branch on or index by
+// secret data, and begin() runs as many windows as the modulus has whatever the exponent.
+// Only the length of the modulus is not hidden.
+class ModExp {
+  public:
+    const static size_t MAX_LIMBS = 64; // 2048 bit
+
+  private:
+    const static size_t WINDOW_BITS = 4;
+    const static size_t RR_DOUBLINGS_PER_STEP = 16;
+    const static size_t MULS_PER_STEP = 1024; // Multiplications are split into rows to stay within this
+
+    using Limbs = std::array<uint32_t, MAX_LIMBS>;
+
+    enum class Phase {
+        Idle,
+        Setup,
+        Reduce,
+        Table,
+        Exponent,
+        Finish,
+        Done,
+    };
+
+    // Montgomery multiplication in progress, a few rows per step.
+    struct Multiplication {
+        bool active;
+        size_t row;
+        Limbs *out;
+        const Limbs *a;
+        const Limbs *b;
+        std::array<uint32_t, MAX_LIMBS + 2> product;
+    };
+
+    size_t m_limbs;
+    size_t m_rows_per_step;
+    Limbs m_modulus;
+    uint32_t m_modulus_inv; // -modulus^-1 mod 2^32
+
+    Limbs m_rr; // R^2 mod modulus, R = 2^(32 * m_limbs)
+    Limbs m_base_low;
+    Limbs m_base_high;
+    Limbs m_exponent;
+    size_t m_window_count;
+    bool m_multiply_only;
+
+    std::array<Limbs, 1 << WINDOW_BITS> m_table; // base^i * R mod modulus
+    Limbs m_operand;                             // Second factor which isn't in the table
+    Limbs m_acc;
+
+    Phase m_phase;
+    size_t m_index;
+    Multiplication m_mul;
+
+    static void fromBytes(Limbs &limbs, size_t limb_count, const uint8_t *bytes, size_t length);
+
+    void reduceOnce(uint32_t *value, uint32_t high) const;
+    void startMul(Limbs &out, const Limbs &a, const Limbs &b);
+    void continueMul();
+    uint8_t getWindow(size_t window) const;
+    void select(Limbs &out, uint8_t index) const;
+
+    bool setup(const uint8_t *base, size_t base_length, const uint8_t *modulus, size_t modulus_length);
+
+  public:
+    ModExp();
+
+    // Starts computing base^exponent mod modulus, all big endian. The modulus needs to be odd
+    // and `base` may be at most twice as long as the modulus. The exponent is secret and may
+    // not be larger than the modulus. Returns false on invalid input.
+    bool begin(const uint8_t *base, size_t base_length, const uint8_t *exponent, size_t exponent_length,
+               const uint8_t *modulus, size_t modulus_length);
+    // Same for a public exponent, which may be longer than the modulus. Takes time by its bit
+    // length, so short exponents are fast.
+    bool beginPublic(const uint8_t *base, size_t base_length, const uint8_t *exponent, size_t exponent_length,
+                     const uint8_t *modulus, size_t modulus_length);
+
+    // Starts computing a * b mod modulus instead, `a` has the same limits as `base` above and
+    // `b` may be as long as the modulus.
+    bool beginMultiply(const uint8_t *a, size_t a_length, const uint8_t *b, size_t b_length, const uint8_t *modulus,
+                       size_t modulus_length);
+
+    // Returns true once the result is available.
+    bool step();
+    bool done() const { return m_phase == Phase::Done && !m_mul.active; };
+
+    // Writes the result big endian, left padded to `length`.
+    void getResult(uint8_t *out, size_t length) const;
+};
+
+} // namespace Divacon::Utils
+
+#endif // _UTILS_MODEXP_H_
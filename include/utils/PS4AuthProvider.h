@@ -1,12 +1,13 @@
 #ifndef _UTILS_PS4AUTHPROVIDER_H_
 #define _UTILS_PS4AUTHPROVIDER_H_
 
+#include "utils/ModExp.h"
+
 #include "mbedtls/pk.h"
 
 #include <array>
 #include <optional>
 #include <stdint.h>
-#include <string>
 
 namespace Divacon::Utils {
 
@@ -19,19 +20,63 @@ class PS4AuthProvider {
         bool enabled;
         std::array<uint8_t, SERIAL_LENGTH> serial;
         std::array<uint8_t, SIGNATURE_LENGTH> signature;
-        std::string key_pem;
+        const char *key_pem; // Null terminated, mbedtls wants the terminator counted in the length
     };
 
+    using Signature = std::array<uint8_t, SIGNATURE_LENGTH>;
+
   private:
+    static constexpr size_t HASH_LENGTH = 32;
+    static constexpr size_t SALT_LENGTH = HASH_LENGTH;
+
+    // Big endian key component, at most as long as the modulus.
+    struct KeyPart {
+        std::array<uint8_t, SIGNATURE_LENGTH> data;
+        size_t length;
+    };
+
+    enum class Phase {
+        Idle,
+        ExpP,
+        ExpQ,
+        CombineP,
+        CombineN,
+        Verify,
+        Done,
+    };
+
     bool m_key_valid;
 
     mbedtls_pk_context m_pk_context;
+    size_t m_modulus_bits;
+    KeyPart m_n, m_e, m_p, m_q, m_dp, m_dq, m_qp;
+    KeyPart m_p_multiple;
+
+    Phase m_phase;
+    ModExp m_exp;
+    Signature m_encoded;
+    KeyPart m_m1, m_m2;
+    Signature m_signature;
+    bool m_signature_valid;
+
+    bool exportKey();
+    bool encode(const Signature &challenge);
+    void advance();
 
   public:
     PS4AuthProvider();
     ~PS4AuthProvider();
 
-    std::optional<std::array<uint8_t, SIGNATURE_LENGTH>> sign(const std::array<uint8_t, SIGNATURE_LENGTH> &challenge);
+    // Starts signing `challenge`, abandoning any signature in progress. Returns false if
+    // there is no usable key.
+    bool begin(const Signature &challenge);
+
+    // Continues the signature for about `budget_us`, returns true once it is finished. Work is
+    // done in ModExp steps, so a call overruns the budget by at most one of those.
+    bool step(uint32_t budget_us);
+
+    // Result of the last finished signature.
+    std::optional<Signature> getSignature() const;
 };
 
 } // namespace Divacon::Utils
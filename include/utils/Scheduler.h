@@ -0,0 +1,82 @@
+#ifndef _UTILS_SCHEDULER_H_
+#define _UTILS_SCHEDULER_H_
+
+#include "utils/InplaceFunction.h"
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Divacon::Utils {
+
+// Cooperative earliest-deadline-first scheduler. Tasks are released periodically and/or
+// by trigger() and always run to completion. Times are microseconds from the clock
+// passed in, which is allowed to wrap.
+class Scheduler {
+  public:
+    const static size_t MAX_TASKS = 8;
+    const static size_t MAX_CAPTURES = 16; // References a task function can capture
+
+    using TaskId = size_t;
+    const static TaskId INVALID_TASK = SIZE_MAX;
+    using Clock = uint32_t (*)();
+    using TaskFunction = InplaceFunction<void(uint32_t now_us), MAX_CAPTURES * sizeof(void *)>;
+
+    struct TaskConfig {
+        const char *name;
+        uint32_t period_us;   // 0 for tasks which only run when triggered
+        uint32_t deadline_us; // Relative to the release
+        uint8_t priority;     // Breaks ties between equal deadlines, higher runs first
+    };
+
+    struct TaskStats {
+        const char *name;
+        uint32_t runs;
+        uint32_t misses;         // Finished after the deadline or skipped whole periods
+        uint32_t max_latency_us; // Release to start of the task
+        uint32_t max_runtime_us;
+        uint32_t total_runtime_us;
+    };
+
+  private:
+    struct Task {
+        TaskConfig config;
+        TaskFunction function;
+
+        bool released;
+        uint32_t release_us;
+        uint32_t next_release_us;
+        uint32_t deadline_us;
+
+        TaskStats stats;
+    };
+
+    Clock m_clock;
+    std::array<Task, MAX_TASKS> m_tasks;
+    size_t m_task_count;
+
+    void release(uint32_t now_us);
+
+  public:
+    Scheduler(Clock clock);
+
+    // Returns INVALID_TASK once all MAX_TASKS slots are taken.
+    TaskId addTask(const TaskConfig &config, TaskFunction function);
+
+    // Releases a task right away. Triggering an already released task keeps its deadline, invalid ids are ignored.
+    void trigger(TaskId id);
+
+    // Runs the most urgent released task, returns false if there was none.
+    bool runNext();
+
+    // Time until the next periodic release, 0 if a task is released already.
+    uint32_t getIdleTime();
+
+    size_t getTaskCount() const { return m_task_count; };
+    const TaskStats &getStats(TaskId id) const { return m_tasks[id].stats; };
+    void resetStats();
+};
+
+} // namespace Divacon::Utils
+
+#endif // _UTILS_SCHEDULER_H_
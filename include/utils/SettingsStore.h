@@ -10,11 +10,19 @@ namespace Divacon::Utils {
 
 class SettingsStore {
   private:
-    const static uint32_t m_flash_size = FLASH_SECTOR_SIZE;
+    // Records are appended to one of two sectors, the other one is erased ahead of time
+    // so a save never has to wait for an erase.
+    const static uint32_t m_sector_count = 2;
+    const static uint32_t m_flash_size = m_sector_count * FLASH_SECTOR_SIZE;
     const static uint32_t m_flash_offset = PICO_FLASH_SIZE_BYTES - m_flash_size;
     const static uint32_t m_store_size = FLASH_PAGE_SIZE;
-    const static uint32_t m_store_pages = m_flash_size / m_store_size;
+    const static uint32_t m_store_pages = FLASH_SECTOR_SIZE / m_store_size;
+
+    // Input idle time required before touching flash while the host is polling.
+    const static uint32_t m_program_idle_ms = 250;
+    const static uint32_t m_erase_idle_ms = 3000;
     const static uint8_t m_magic_byte = 0x39;
+    const static size_t m_usb_mode_count = USB_MODE_DEBUG + 1;
 
     struct __attribute((packed, aligned(1))) Storecache {
         uint8_t in_use;
@@ -28,13 +36,16 @@ class SettingsStore {
         bool led_enable_player_color;
         bool led_enable_pdloader_support;
         bool buttons_mirror_to_dpad;
+        uint8_t usb_poll_interval[m_usb_mode_count]; // 0 selects the default
+        uint32_t generation;                         // Newest by wrap-safe compare, 0 for legacy records
+        uint32_t crc;                                // CRC-32 over everything above, absent in legacy records
 
         uint8_t _padding[m_store_size - sizeof(uint8_t) - sizeof(usb_mode_t) - sizeof(uint8_t) - sizeof(uint8_t) -
                          sizeof(Peripherals::TouchSliderLeds::Config::IdleMode) -
                          sizeof(Peripherals::TouchSliderLeds::Config::TouchedMode) -
                          sizeof(Peripherals::TouchSliderLeds::Config::Color) -
                          sizeof(Peripherals::TouchSliderLeds::Config::Color) - sizeof(bool) - sizeof(bool) -
-                         sizeof(bool)];
+                         sizeof(bool) - (sizeof(uint8_t) * m_usb_mode_count) - sizeof(uint32_t) - sizeof(uint32_t)];
     };
     static_assert(sizeof(Storecache) == m_store_size);
 
@@ -46,11 +57,23 @@ class SettingsStore {
 
     Storecache m_store_cache;
     bool m_dirty;
+    bool m_store_requested;
+
+    uint32_t m_sector;    // Sector holding the latest record
+    uint32_t m_next_page; // Next free page in m_sector
+    bool m_spare_erased;  // Whether the other sector is ready to be written
+
+    uint32_t m_flash_operations;
+    uint32_t m_longest_stall_us;
 
     RebootType m_scheduled_reboot;
 
   private:
-    Storecache read();
+    static uint32_t pageOffset(uint32_t sector, uint32_t page);
+    static uint32_t checksum(const Storecache &record);
+
+    void program();
+    void eraseSpare();
 
   public:
     SettingsStore();
@@ -85,10 +108,22 @@ class SettingsStore {
     void setInputMirrorToDpad(bool do_mirror);
     bool getInputMirrorToDpad();
 
+    void setUsbPollInterval(usb_mode_t mode, uint8_t interval_ms);
+    uint8_t getUsbPollInterval(usb_mode_t mode);
+
     void scheduleReboot(bool bootsel = false);
 
+    // Requests the current settings to be saved. Happens right away if a reboot is scheduled,
+    // otherwise the write is deferred to task().
     void store();
     void reset();
+
+    // Performs at most one short flash operation if `idle_ms`, the time the host has not seen
+    // any input change, allows for it. Returns true if the flash was accessed.
+    bool task(uint32_t idle_ms);
+
+    uint32_t getFlashOperations() const { return m_flash_operations; };
+    uint32_t getLongestStall() const { return m_longest_stall_us; };
 };
 } // namespace Divacon::Utils
 
@@ -0,0 +1,45 @@
+#ifndef _UTILS_XIPSTATS_H_
+#define _UTILS_XIPSTATS_H_
+
+#include <stdint.h>
+
+// Counters are compiled out unless the firmware is configured with -DDIVACON_XIP_STATS=ON.
+#ifndef DIVACON_XIP_STATS
+#define DIVACON_XIP_STATS 0
+#endif
+
+namespace Divacon::Utils::XipStats {
+
+// Sections of the main loop which flash accesses are attributed to.
+enum class Phase : uint8_t {
+    Wait,   // Waiting for the sample window
+    Sample, // Buttons and touch slider
+    Menu,   // Menu and settings
+    Report, // Building and submitting the report
+    Usb,    // TinyUSB and deferred flash writes
+    Other,  // Messaging and telemetry
+    Count,
+};
+
+struct Counters {
+    uint32_t accesses;
+    uint32_t hits;
+};
+
+// Attributes XIP cache accesses since the previous mark to the phase which ends here. The
+// hardware counters are shared, so accesses from core1 are included as well.
+void mark(Phase phase);
+
+const char *getName(Phase phase);
+const Counters &get(Phase phase);
+void reset();
+
+} // namespace Divacon::Utils::XipStats
+
+#if DIVACON_XIP_STATS
+#define XIP_STATS_MARK(phase) ::Divacon::Utils::XipStats::mark(::Divacon::Utils::XipStats::Phase::phase)
+#else
+#define XIP_STATS_MARK(phase) ((void)0)
+#endif
+
+#endif // _UTILS_XIPSTATS_H_
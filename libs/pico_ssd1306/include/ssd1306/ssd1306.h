@@ -60,6 +60,16 @@ typedef enum {
     SET_CHARGE_PUMP = 0x8D
 } ssd1306_command_t;
 
+/**
+ *	@brief size of the display buffer in bytes
+ */
+#define SSD1306_BUFSIZE(width, height) (((height) / 8) * (width))
+
+/**
+ *	@brief size of the dma buffer in halfwords, the display buffer plus addressing commands and control bytes
+ */
+#define SSD1306_DMA_BUFSIZE(width, height) (SSD1306_BUFSIZE(width, height) + 8)
+
 /**
  *	@brief holds the configuration
  */
@@ -91,6 +101,24 @@ typedef struct {
  */
 bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address, i2c_inst_t *i2c_instance);
 
+/**
+ *	@brief initialize display with caller provided buffers instead of allocating them
+ *
+ *	@param[in] p : pointer to instance of ssd1306_t
+ *	@param[in] width : width of display
+ *	@param[in] height : heigth of display
+ *	@param[in] address : i2c address of display
+ *	@param[in] i2c_instance : instance of i2c connection
+ *	@param[in] buffer : display buffer of SSD1306_BUFSIZE(width, height) bytes
+ *	@param[in] dma_buffer : dma buffer of SSD1306_DMA_BUFSIZE(width, height) halfwords
+ *
+ * 	@return bool.
+ *	@retval true for Success
+ *	@retval false if initialization failed
+ */
+bool ssd1306_init_static(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address, i2c_inst_t *i2c_instance,
+                         uint8_t *buffer, uint16_t *dma_buffer);
+
 /**
  *	@brief deinitialize display
  *
@@ -134,13 +162,25 @@ void ssd1306_contrast(ssd1306_t *p, uint8_t val);
 void ssd1306_invert(ssd1306_t *p, uint8_t inv);
 
 /**
-    @brief display buffer, should be called on change
+    @brief display buffer, should be called on change. The buffer is sent by DMA, this only waits if the previous
+    transfer is still running.
 
     @param[in] p : instance of display
 
 */
 void ssd1306_show(ssd1306_t *p);
 
+/**
+    @brief check whether the buffer passed to the last ssd1306_show is still being sent
+
+    @param[in] p : instance of display
+
+    @return bool.
+    @retval true while the transfer is running
+
+*/
+bool ssd1306_busy(ssd1306_t *p);
+
 /**
     @brief clear display buffer
 
@@ -58,11 +58,20 @@ inline static void ssd1306_write(ssd1306_t *p, uint8_t val) {
 inline static void ssd1306_dma_write_buffer(ssd1306_t *p) {
     wait_i2c_ready(p);
 
+    // The addressing commands and the display data are two transfers in one DMA stream, the controller starts the
+    // second one on its own after the stop of the first.
+    const uint8_t cmds[] = {0x00, SET_PAGE_ADDR, 0, 0xFF, SET_COL_ADDR, 0, p->width - 1};
+    for (size_t i = 0; i < sizeof(cmds); ++i) {
+        p->dma_buffer[i] = cmds[i];
+    }
+    p->dma_buffer[sizeof(cmds) - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    uint16_t *data = p->dma_buffer + sizeof(cmds);
     for (size_t i = 0; i < (p->bufsize); ++i) {
-        p->dma_buffer[i + 1] = (p->buffer[i]);
+        data[i + 1] = (p->buffer[i]);
     }
-    p->dma_buffer[0] = 0x40;
-    p->dma_buffer[p->bufsize + 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    data[0] = 0x40;
+    data[p->bufsize] |= I2C_IC_DATA_CMD_STOP_BITS;
 
     dma_channel_config conf = dma_channel_get_default_config(p->dma_channel);
     channel_config_set_read_increment(&conf, true);
@@ -74,10 +83,31 @@ inline static void ssd1306_dma_write_buffer(ssd1306_t *p) {
     i2c_get_hw(p->i2c_i)->tar = p->address;
     i2c_get_hw(p->i2c_i)->enable = 1;
 
-    dma_channel_configure(p->dma_channel, &conf, &i2c_get_hw(p->i2c_i)->data_cmd, p->dma_buffer, p->bufsize + 1, true);
+    dma_channel_configure(p->dma_channel, &conf, &i2c_get_hw(p->i2c_i)->data_cmd, p->dma_buffer,
+                          sizeof(cmds) + p->bufsize + 1, true);
 }
 
 bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address, i2c_inst_t *i2c_instance) {
+    const size_t bufsize = SSD1306_BUFSIZE(width, height);
+
+    uint8_t *buffer = malloc(bufsize);
+    if (buffer == NULL) {
+        p->bufsize = 0;
+        return false;
+    }
+
+    uint16_t *dma_buffer = malloc(SSD1306_DMA_BUFSIZE(width, height) * sizeof(uint16_t));
+    if (dma_buffer == NULL) {
+        free(buffer);
+        p->bufsize = 0;
+        return false;
+    }
+
+    return ssd1306_init_static(p, width, height, address, i2c_instance, buffer, dma_buffer);
+}
+
+bool ssd1306_init_static(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address, i2c_inst_t *i2c_instance,
+                         uint8_t *buffer, uint16_t *dma_buffer) {
     p->width = width;
     p->height = height;
     p->pages = height / 8;
@@ -85,16 +115,11 @@ bool ssd1306_init(ssd1306_t *p, uint16_t width, uint16_t height, uint8_t address
 
     p->i2c_i = i2c_instance;
 
-    p->bufsize = (p->pages) * (p->width);
-    if ((p->buffer = malloc(p->bufsize)) == NULL) {
-        p->bufsize = 0;
-        return false;
-    }
+    p->bufsize = SSD1306_BUFSIZE(width, height);
+    p->buffer = buffer;
+    p->dma_buffer = dma_buffer;
 
     p->dma_channel = dma_claim_unused_channel(true);
-    if ((p->dma_buffer = malloc((p->bufsize + 1) * sizeof(uint16_t))) == NULL) {
-        return false;
-    }
 
     // from https://github.com/makerportal/rpi-pico-ssd1306
     uint8_t cmds[] = {
@@ -288,11 +313,8 @@ inline void ssd1306_bmp_show_image(ssd1306_t *p, const uint8_t *data, const long
     ssd1306_bmp_show_image_with_offset(p, data, size, 0, 0);
 }
 
-void ssd1306_show(ssd1306_t *p) {
-    uint8_t payload[] = {SET_PAGE_ADDR, 0, 0xFF, SET_COL_ADDR, 0, p->width - 1};
-
-    for (size_t i = 0; i < sizeof(payload); ++i)
-        ssd1306_write(p, payload[i]);
+bool ssd1306_busy(ssd1306_t *p) {
+    return dma_channel_is_busy(p->dma_channel) || !(i2c_get_hw(p->i2c_i)->status & I2C_IC_STATUS_TFE_BITS);
+}
 
-    ssd1306_dma_write_buffer(p);
-}
\ No newline at end of file
+void ssd1306_show(ssd1306_t *p) { ssd1306_dma_write_buffer(p); }
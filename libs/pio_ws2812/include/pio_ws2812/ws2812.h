@@ -9,8 +9,21 @@ extern "C" {
 
 void ws2812_init(uint8_t pin, bool is_rgbw);
 
+#define WS2812_MAX_STRIPS 4
+
+// Double buffered output which is fed to the state machines by DMA. Each of the `count` strips has its own state
+// machine and DMA channel and all of them are sent in parallel. Frames hold the pixels of all strips back to back,
+// `lengths[idx]` pixels for the strip on `pins[idx]`. Both buffers are owned by the caller.
+// Render into ws2812_get_back_buffer() and pass it on with ws2812_swap_buffers(), which returns right away. It returns
+// false and keeps the buffers if the previous frame and its reset gap aren't finished yet.
+void ws2812_init_dma(const uint8_t *pins, const size_t *lengths, size_t count, bool is_rgbw, uint32_t *front,
+                     uint32_t *back);
+uint32_t *ws2812_get_back_buffer(void);
+bool ws2812_swap_buffers(void);
+
 uint32_t ws2812_rgb_to_u32pixel(uint8_t r, uint8_t g, uint8_t b);
 uint32_t ws2812_rgb_to_gamma_corrected_u32pixel(uint8_t r, uint8_t g, uint8_t b);
+uint8_t ws2812_gamma_correct(uint8_t value);
 
 void ws2812_put_pixel(uint32_t pixel_grb);
 void ws2812_put_frame(uint32_t *frame, size_t length);
@@ -8,6 +8,8 @@
 #include "ws2812.pio.h"
 
 #include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 #include "hardware/pio.h"
 
 static const uint8_t gamma_correct[] = {
@@ -24,23 +26,132 @@ static const uint8_t gamma_correct[] = {
     169, 171, 173, 175, 177, 180, 182, 184, 186, 189, 191, 193, 196, 198, 200, 203, 205, 208, 210, 213, 215, 218,
     220, 223, 225, 228, 231, 233, 236, 239, 241, 244, 247, 249, 252, 255};
 
-void ws2812_init(uint8_t pin, bool is_rgbw) {
-    PIO pio = pio0;
-    int sm = 0;
-    uint offset = pio_add_program(pio, &ws2812_program);
+#define WS2812_DMA_IRQ DMA_IRQ_1
 
-    ws2812_program_init(pio, sm, offset, pin, 800000, is_rgbw);
+// The strip latches the frame after the line was held low for this long.
+static const uint32_t reset_us = 60;
+
+static uint32_t bits_per_pixel = 24;
+
+static int program_offset = -1;
+
+static size_t strip_count;
+static int dma_channels[WS2812_MAX_STRIPS];
+static size_t strip_offsets[WS2812_MAX_STRIPS];
+static size_t strip_lengths[WS2812_MAX_STRIPS];
+
+static uint32_t *dma_buffers[2];
+static uint8_t dma_back;
+static volatile uint32_t dma_in_flight; // One bit per strip
+static volatile uint32_t dma_ready_us;
+
+static void ws2812_init_sm(uint sm, uint8_t pin, bool is_rgbw) {
+    if (program_offset < 0) {
+        program_offset = pio_add_program(pio0, &ws2812_program);
+    }
+
+    bits_per_pixel = is_rgbw ? 32 : 24;
+
+    ws2812_program_init(pio0, sm, program_offset, pin, 800000, is_rgbw);
 }
 
+void ws2812_init(uint8_t pin, bool is_rgbw) { ws2812_init_sm(0, pin, is_rgbw); }
+
+static void ws2812_dma_irq_handler(void) {
+    bool completed = false;
+    for (size_t idx = 0; idx < strip_count; ++idx) {
+        if (dma_irqn_get_channel_status(1, dma_channels[idx])) {
+            dma_irqn_acknowledge_channel(1, dma_channels[idx]);
+            dma_in_flight &= ~(1u << idx);
+            completed = true;
+        }
+    }
+
+    if (completed && dma_in_flight == 0) {
+        // The last pixels are still in the joined FIFO and the OSR when the DMA completes. They take 1.25us per bit.
+        const uint32_t drain_us = ((8 + 1) * bits_per_pixel * 5 + 3) / 4;
+
+        dma_ready_us = time_us_32() + drain_us + reset_us;
+    }
+}
+
+void ws2812_init_dma(const uint8_t *pins, const size_t *lengths, size_t count, bool is_rgbw, uint32_t *front,
+                     uint32_t *back) {
+    dma_buffers[0] = front;
+    dma_buffers[1] = back;
+    dma_back = 1;
+    dma_in_flight = 0;
+    dma_ready_us = time_us_32();
+
+    strip_count = count < WS2812_MAX_STRIPS ? count : WS2812_MAX_STRIPS;
+
+    size_t offset = 0;
+    for (size_t idx = 0; idx < strip_count; ++idx) {
+        ws2812_init_sm(idx, pins[idx], is_rgbw);
+
+        strip_offsets[idx] = offset;
+        strip_lengths[idx] = lengths[idx];
+        offset += lengths[idx];
+
+        dma_channels[idx] = dma_claim_unused_channel(true);
+
+        dma_channel_config conf = dma_channel_get_default_config(dma_channels[idx]);
+        channel_config_set_transfer_data_size(&conf, DMA_SIZE_32);
+        channel_config_set_read_increment(&conf, true);
+        channel_config_set_write_increment(&conf, false);
+        channel_config_set_dreq(&conf, pio_get_dreq(pio0, idx, true));
+        dma_channel_configure(dma_channels[idx], &conf, &pio0->txf[idx], NULL, lengths[idx], false);
+
+        dma_irqn_set_channel_enabled(1, dma_channels[idx], true);
+    }
+
+    irq_add_shared_handler(WS2812_DMA_IRQ, ws2812_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(WS2812_DMA_IRQ, true);
+}
+
+uint32_t *ws2812_get_back_buffer(void) { return dma_buffers[dma_back]; }
+
+bool ws2812_swap_buffers(void) {
+    if (dma_in_flight || (int32_t)(time_us_32() - dma_ready_us) < 0) {
+        return false;
+    }
+
+    uint32_t in_flight = 0;
+    uint32_t channel_mask = 0;
+    for (size_t idx = 0; idx < strip_count; ++idx) {
+        if (strip_lengths[idx] == 0) {
+            continue;
+        }
+
+        dma_channel_set_read_addr(dma_channels[idx], dma_buffers[dma_back] + strip_offsets[idx], false);
+        dma_channel_set_trans_count(dma_channels[idx], strip_lengths[idx], false);
+
+        in_flight |= 1u << idx;
+        channel_mask |= 1u << dma_channels[idx];
+    }
+
+    // All strips start together, so the frame takes as long as the longest one.
+    dma_in_flight = in_flight;
+    dma_start_channel_mask(channel_mask);
+
+    dma_back ^= 1;
+
+    return true;
+}
+
+// Pixels are stored pre-shifted, the state machine sends bits starting at the MSB.
 uint32_t ws2812_rgb_to_u32pixel(uint8_t r, uint8_t g, uint8_t b) {
-    return ((uint32_t)(r) << 8) | ((uint32_t)(g) << 16) | (uint32_t)(b);
+    return ((uint32_t)(r) << 16) | ((uint32_t)(g) << 24) | ((uint32_t)(b) << 8);
 }
 
 uint32_t ws2812_rgb_to_gamma_corrected_u32pixel(uint8_t r, uint8_t g, uint8_t b) {
-    return ((uint32_t)(gamma_correct[r]) << 8) | ((uint32_t)(gamma_correct[g]) << 16) | (uint32_t)(gamma_correct[b]);
+    return ((uint32_t)(gamma_correct[r]) << 16) | ((uint32_t)(gamma_correct[g]) << 24) |
+           ((uint32_t)(gamma_correct[b]) << 8);
 }
 
-void ws2812_put_pixel(uint32_t pixel_grb) { pio_sm_put_blocking(pio0, 0, pixel_grb << 8u); }
+uint8_t ws2812_gamma_correct(uint8_t value) { return gamma_correct[value]; }
+
+void ws2812_put_pixel(uint32_t pixel_grb) { pio_sm_put_blocking(pio0, 0, pixel_grb); }
 
 void ws2812_put_frame(uint32_t *frame, size_t length) {
     for (size_t i = 0; i < length; ++i) {
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+# Input sections which are only linked in if something allocates from the heap.
+HEAP_SECTIONS = {
+    ".text.__wrap_malloc",
+    ".text.__wrap_calloc",
+    ".text.__wrap_realloc",
+    ".text._malloc_r",
+    ".text._calloc_r",
+    ".text._realloc_r",
+    ".text.malloc",
+    ".text.calloc",
+    ".text.realloc",
+    ".text._Znwj",
+    ".text._Znaj",
+}
+
+RAM_REGIONS = ("RAM", "SCRATCH_X", "SCRATCH_Y")
+
+REGION_LINE = re.compile(r"^(\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)")
+SECTION_LINE = re.compile(r"^ ?(\.\S+|COMMON)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*))?$")
+CONTINUATION_LINE = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+FILL_LINE = re.compile(r"^ \*fill\*\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)")
+
+
+STACKS = {".stack_dummy": "core0", ".stack1_dummy": "core1"}
+
+
+def subsystem(path):
+    path = path.replace("\\", "/")
+
+    # Firmware sources are compiled relative to the project
+    match = re.search(r"\.dir/src/(.+?)\.(?:c|cpp)\.obj$", path)
+    if match:
+        return match.group(1)
+
+    match = re.search(r"(?:^|/)libs/([^/]+)/", path)
+    if match:
+        return "libs/" + match.group(1)
+
+    for name in ("tinyusb", "mbedtls"):
+        if "/lib/{}/".format(name) in path:
+            return name
+
+    match = re.search(r"(lib[\w+]+)\.a\(", path)
+    if match:
+        return "toolchain/" + match.group(1)
+
+    return "pico-sdk"
+
+
+def parse(map_path):
+    regions = {}
+    sections = []  # (output section, input section, address, size, object)
+    fill = []  # (output section, address, size)
+
+    with open(map_path, "rt") as map_file:
+        lines = map_file.read().splitlines()
+
+    idx = 0
+    while idx < len(lines) and lines[idx] != "Memory Configuration":
+        idx += 1
+    while idx < len(lines) and lines[idx] != "Linker script and memory map":
+        match = REGION_LINE.match(lines[idx])
+        if match and match.group(1) in RAM_REGIONS:
+            regions[match.group(1)] = (int(match.group(2), 16), int(match.group(3), 16))
+        idx += 1
+
+    output_section = None
+    pending = None
+    for line in lines[idx:]:
+        if line.startswith("."):
+            output_section = line.split()[0]
+            pending = None
+            continue
+
+        if pending:
+            match = CONTINUATION_LINE.match(line)
+            if match:
+                sections.append(
+                    (output_section, pending, int(match.group(1), 16), int(match.group(2), 16), match.group(3))
+                )
+            pending = None
+            continue
+
+        match = FILL_LINE.match(line)
+        if match:
+            fill.append((output_section, int(match.group(1), 16), int(match.group(2), 16)))
+            continue
+
+        match = SECTION_LINE.match(line)
+        if match:
+            if match.group(2) is None:
+                pending = match.group(1)
+            else:
+                sections.append(
+                    (output_section, match.group(1), int(match.group(2), 16), int(match.group(3), 16), match.group(4))
+                )
+
+    return regions, sections, fill
+
+
+def region_of(regions, address):
+    for name, (origin, length) in regions.items():
+        if origin <= address < origin + length:
+            return name
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report RAM usage per subsystem from a linker map file.")
+    parser.add_argument("map", help="linker map file of the firmware")
+    parser.add_argument("--output", help="also write the report to this file")
+    parser.add_argument("--no-heap", action="store_true", help="fail if the heap allocator has been linked in")
+    args = parser.parse_args()
+
+    regions, sections, fill = parse(args.map)
+    if not regions:
+        raise Exception("No RAM regions found in '{}'.".format(args.map))
+
+    usage = defaultdict(int)
+    stacks = {}
+    heap = 0
+    used = defaultdict(int)
+    for output_section, name, address, size, path in sections:
+        region = region_of(regions, address)
+        if region is None or size == 0:
+            continue
+
+        used[region] += size
+        if output_section.startswith(".stack"):
+            stack = STACKS.get(output_section, output_section)
+            stacks[stack] = stacks.get(stack, 0) + size
+        elif output_section == ".heap":
+            heap += size
+        else:
+            usage[subsystem(path)] += size
+
+    padding = 0
+    for output_section, address, size in fill:
+        region = region_of(regions, address)
+        if region is not None:
+            used[region] += size
+            padding += size
+
+    report = ["RAM by subsystem (bytes):"]
+    for name, size in sorted(usage.items(), key=lambda item: item[1], reverse=True):
+        report.append("  {:<32} {:>7}".format(name, size))
+    report.append("  {:<32} {:>7}".format("(alignment padding)", padding))
+
+    report.append("Stacks (bytes):")
+    for name, size in sorted(stacks.items()):
+        report.append("  {:<32} {:>7}".format(name, size))
+    report.append("  {:<32} {:>7}".format("heap (reserved)", heap))
+
+    report.append("Regions (bytes):")
+    for name in RAM_REGIONS:
+        if name in regions:
+            length = regions[name][1]
+            report.append(
+                "  {:<32} {:>7} used {:>7} free of {:>7}".format(name, used[name], length - used[name], length)
+            )
+
+    heap_sections = sorted(
+        {(name, path) for _, name, _, size, path in sections if name in HEAP_SECTIONS and size > 0}
+    )
+    if heap_sections:
+        report.append("Heap allocator linked in:")
+        for name, path in heap_sections:
+            report.append("  {} ({})".format(name[len(".text.") :], path))
+        if args.no_heap:
+            report.append("Remove the allocations above, or build without DIVACON_NO_HEAP.")
+
+    print("\n".join(report))
+    if args.output:
+        with open(args.output, "wt") as output:
+            output.write("\n".join(report) + "\n")
+
+    return 1 if args.no_heap and heap_sections else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -5,43 +5,40 @@
 #include "peripherals/TouchSliderLeds.h"
 #include "usb/device/hid/ps4_auth.h"
 #include "usb/device_driver.h"
+#include "utils/InputPhaseLock.h"
 #include "utils/InputState.h"
+#include "utils/InterCore.h"
+#include "utils/LatencyProbes.h"
 #include "utils/Menu.h"
 #include "utils/PS4AuthProvider.h"
+#include "utils/Scheduler.h"
 #include "utils/SettingsStore.h"
+#include "utils/XipStats.h"
 
 #include "GlobalConfiguration.h"
 #include "PS4AuthConfiguration.h"
 
+#include "mbedtls/memory_buffer_alloc.h"
 #include "pico/multicore.h"
 #include "pico/stdlib.h"
-#include "pico/util/queue.h"
 
-#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <inttypes.h>
+#include <limits>
+#include <optional>
 #include <stdio.h>
 
-using namespace Divacon;
-
-queue_t control_queue;
-queue_t menu_display_queue;
-queue_t input_queue;
-queue_t led_queue;
+#ifndef DIVACON_TOUCH_ON_CORE1
+#define DIVACON_TOUCH_ON_CORE1 0
+#endif
 
-queue_t auth_challenge_queue;
-queue_t auth_signed_challenge_queue;
+using namespace Divacon;
 
 enum class ControlCommand {
-    SetUsbMode,
     SetPlayerLed,
     SetButtonLed,
-    SetLedBrightness,
-    SetLedAnimationSpeed,
-    SetLedIdleMode,
-    SetLedTouchedMode,
-    SetLedIdleColor,
-    SetLedTouchedColor,
-    SetLedEnablePlayerColor,
-    SetLedEnablePdloaderSupport,
+    SetLatency,
     EnterMenu,
     ExitMenu,
 };
@@ -49,42 +46,402 @@ enum class ControlCommand {
 struct ControlMessage {
     ControlCommand command;
     union {
-        usb_mode_t usb_mode;
         usb_player_led_t player_led;
         usb_button_led_t button_led;
-        uint8_t led_brightness;
-        uint8_t led_animation_speed;
-        Peripherals::TouchSliderLeds::Config::IdleMode led_idle_mode;
-        Peripherals::TouchSliderLeds::Config::TouchedMode led_touched_mode;
-        Peripherals::TouchSliderLeds::Config::Color led_idle_color;
-        Peripherals::TouchSliderLeds::Config::Color led_touched_color;
-        bool led_enable_player_color;
-        bool led_enable_pdloader_support;
+        Utils::LatencyHistogram::Summary latency;
     } data;
 };
 
+// Settings used on core1, published as a whole whenever one of them changes.
+struct SettingsMessage {
+    usb_mode_t usb_mode;
+    uint8_t led_brightness;
+    uint8_t led_animation_speed;
+    Peripherals::TouchSliderLeds::Config::IdleMode led_idle_mode;
+    Peripherals::TouchSliderLeds::Config::TouchedMode led_touched_mode;
+    Peripherals::TouchSliderLeds::Config::Color led_idle_color;
+    Peripherals::TouchSliderLeds::Config::Color led_touched_color;
+    bool led_enable_player_color;
+    bool led_enable_pdloader_support;
+
+    bool operator==(const SettingsMessage &rhs) const {
+        return usb_mode == rhs.usb_mode && led_brightness == rhs.led_brightness &&
+               led_animation_speed == rhs.led_animation_speed && led_idle_mode == rhs.led_idle_mode &&
+               led_touched_mode == rhs.led_touched_mode && led_idle_color == rhs.led_idle_color &&
+               led_touched_color == rhs.led_touched_color && led_enable_player_color == rhs.led_enable_player_color &&
+               led_enable_pdloader_support == rhs.led_enable_pdloader_support;
+    }
+    bool operator!=(const SettingsMessage &rhs) const { return !operator==(rhs); }
+};
+
+// Touch state scanned on core1, stamped with the time the scan started.
+struct TouchFrameMessage {
+    uint32_t touched;
+    uint32_t scanned_us;
+};
+
+// Input path timing on core0, to compare touch scanning on either core.
+struct Core0Stats {
+    Utils::LatencyHistogram touch_age = Utils::LatencyHistogram(50);
+    Utils::LatencyHistogram usb_task_interval = Utils::LatencyHistogram(50);
+    uint32_t touch_frames = 0;
+    uint32_t flash_usb_gap_us = 0; // Longest USB task interval caused by saving settings
+};
+
+using AuthChallenge = std::array<uint8_t, Utils::PS4AuthProvider::SIGNATURE_LENGTH>;
+
+Utils::SpscRing<ControlMessage, 32> control_ring;
+Utils::Mailbox<SettingsMessage> settings_mailbox;
+Utils::Mailbox<Utils::Menu::State> menu_display_mailbox;
+Utils::Mailbox<Utils::InputState::InputMessage> input_mailbox;
+Utils::TripleBuffer<Peripherals::TouchSliderLeds::RawFrameMessage> led_frames;
+
+Utils::Handshake<AuthChallenge, std::optional<AuthChallenge>> auth_handshake;
+
+#if DIVACON_TOUCH_ON_CORE1
+Utils::Mailbox<TouchFrameMessage> touch_frame_mailbox;
+// Set up on core0 before core1 is launched, only scanned on core1 afterwards.
+Peripherals::TouchSlider *core1_touch_slider = nullptr;
+#endif
+
+// Rung by core0 after posting anything for core1, which otherwise sleeps until its next task is due.
+Utils::Doorbell core1_doorbell;
+
+struct Core1Stats {
+    Utils::LatencyHistogram::Summary wake;
+    uint32_t auth_sign_us; // Duration of the last PS4 challenge signature
+    std::array<Utils::Scheduler::TaskStats, Utils::Scheduler::MAX_TASKS> tasks;
+    size_t task_count;
+    Peripherals::TouchSliderLeds::FrameStats slider_led_frames;
+    Utils::LatencyHistogram::Summary slider_led_raw_latency;
+    Utils::LatencyHistogram::Summary slider_led_frame_time;
+    Utils::LatencyHistogram::Summary slider_led_frame_jitter;
+    Utils::LatencyHistogram::Summary touch_scan_interval;
+};
+
+Utils::Mailbox<Core1Stats> core1_stats_mailbox;
+
+// mbedtls allocates from here instead of the heap. It is used on core0 until core1 has been
+// launched and only on core1 afterwards, so the arena needs no locking.
+static uint8_t mbedtls_arena[12 * 1024];
+
+static uint32_t control_coalesced = 0;
+
+// Time from leaving the menu with a new USB mode to the first report picked up by the host.
+static struct {
+    uint32_t started_us;
+    uint32_t duration_us;
+    bool pending;
+} mode_switch_timing = {0, 0, false};
+
+// Whether `msg` would not change anything on core1 after `previous` has been applied.
+static bool isRedundant(const ControlMessage &msg, const ControlMessage &previous) {
+    if (msg.command != previous.command) {
+        return false;
+    }
+
+    switch (msg.command) {
+    case ControlCommand::SetPlayerLed:
+        if (msg.data.player_led.type != previous.data.player_led.type) {
+            return false;
+        }
+        if (msg.data.player_led.type == USB_PLAYER_LED_ID) {
+            return msg.data.player_led.id == previous.data.player_led.id;
+        }
+        return msg.data.player_led.red == previous.data.player_led.red &&
+               msg.data.player_led.green == previous.data.player_led.green &&
+               msg.data.player_led.blue == previous.data.player_led.blue;
+    case ControlCommand::SetButtonLed:
+        return msg.data.button_led.north == previous.data.button_led.north &&
+               msg.data.button_led.east == previous.data.button_led.east &&
+               msg.data.button_led.south == previous.data.button_led.south &&
+               msg.data.button_led.west == previous.data.button_led.west;
+    case ControlCommand::SetLatency:
+    case ControlCommand::EnterMenu:
+    case ControlCommand::ExitMenu:
+        break;
+    }
+
+    return false;
+}
+
+// Queues a control message for core1 without blocking. Messages equal to the last one
+// queued for the same command are coalesced. Only to be called from core0.
+static bool sendControl(const ControlMessage &msg) {
+    // Indexed by command.
+    static std::array<std::optional<ControlMessage>, static_cast<size_t>(ControlCommand::ExitMenu) + 1> last_sent;
+
+    auto &last = last_sent[static_cast<size_t>(msg.command)];
+    if (last && isRedundant(msg, *last)) {
+        control_coalesced++;
+        return true;
+    }
+
+    if (!control_ring.tryPush(msg)) {
+        return false;
+    }
+    core1_doorbell.ring();
+
+    last = msg;
+    return true;
+}
+
+static void printTelemetry(Utils::InputPhaseLock &input_phase_lock, Core0Stats &core0_stats,
+                           const Utils::SettingsStore &settings_store) {
+    static const uint32_t interval_ms = 1000;
+    static uint32_t last_print = 0;
+
+    const uint32_t now = to_ms_since_boot(get_absolute_time());
+    if (now - last_print < interval_ms) {
+        return;
+    }
+    last_print = now;
+
+    usbd_report_timing_t timing;
+    usbd_driver_get_report_timing(&timing);
+
+    printf("\nUSB frames: %" PRIu32 " reports: %" PRIu32 " skipped: %" PRIu32
+           " | phase min/avg/max: %u/%u/%u us jitter: %u us | poll min/avg/max: %u/%u/%u us\n",
+           timing.frames, timing.reports, timing.skipped_frames, timing.phase_min_us, timing.phase_avg_us,
+           timing.phase_max_us, timing.phase_max_us - timing.phase_min_us, timing.poll_min_us, timing.poll_avg_us,
+           timing.poll_max_us);
+
+    printf("IPC input overwritten: %" PRIu32 " leds overwritten: %" PRIu32 " control dropped: %" PRIu32
+           " coalesced: %" PRIu32 " auth superseded: %" PRIu32 "\n",
+           input_mailbox.getOverwritten(), led_frames.getOverwritten(), control_ring.getDropped(), control_coalesced,
+           auth_handshake.getSuperseded());
+
+    Core1Stats core1_stats;
+    core1_stats_mailbox.peek(core1_stats);
+    if (core1_stats.wake.count) {
+        printf("Core1 wakeups: %" PRIu32 " latency p50/p90/p99/max: %" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32
+               " us\n",
+               core1_stats.wake.count, core1_stats.wake.p50_us, core1_stats.wake.p90_us, core1_stats.wake.p99_us,
+               core1_stats.wake.max_us);
+    }
+    if (core1_stats.task_count) {
+        printf("Core1 tasks runs/misses/max latency/avg runtime/max runtime us:");
+        for (size_t id = 0; id < core1_stats.task_count; ++id) {
+            const auto &task = core1_stats.tasks[id];
+            printf(" %s %" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32, task.name, task.runs, task.misses,
+                   task.max_latency_us, task.runs ? task.total_runtime_us / task.runs : 0, task.max_runtime_us);
+        }
+        printf("\n");
+    }
+    printf("Slider LED frames pushed: %" PRIu32 " skipped unchanged: %" PRIu32 " current limited: %" PRIu32
+           " dropped late: %" PRIu32 " reused busy: %" PRIu32 "\n",
+           core1_stats.slider_led_frames.pushed, core1_stats.slider_led_frames.skipped,
+           core1_stats.slider_led_frames.limited, core1_stats.slider_led_frames.dropped,
+           core1_stats.slider_led_frames.reused);
+    if (core1_stats.slider_led_frame_time.count) {
+        printf("Slider LED frame time p50/p99/max: %" PRIu32 "/%" PRIu32 "/%" PRIu32 " us jitter p50/p99/max: %" PRIu32
+               "/%" PRIu32 "/%" PRIu32 " us\n",
+               core1_stats.slider_led_frame_time.p50_us, core1_stats.slider_led_frame_time.p99_us,
+               core1_stats.slider_led_frame_time.max_us, core1_stats.slider_led_frame_jitter.p50_us,
+               core1_stats.slider_led_frame_jitter.p99_us, core1_stats.slider_led_frame_jitter.max_us);
+    }
+    if (core1_stats.slider_led_raw_latency.count) {
+        printf("PDLoader LED frames: %" PRIu32 " receive to send p50/p99/max: %" PRIu32 "/%" PRIu32 "/%" PRIu32
+               " us\n",
+               core1_stats.slider_led_raw_latency.count, core1_stats.slider_led_raw_latency.p50_us,
+               core1_stats.slider_led_raw_latency.p99_us, core1_stats.slider_led_raw_latency.max_us);
+    }
+    if (core1_stats.touch_scan_interval.count) {
+        printf("Core1 touch scan interval p50/p99/max: %" PRIu32 "/%" PRIu32 "/%" PRIu32 " us\n",
+               core1_stats.touch_scan_interval.p50_us, core1_stats.touch_scan_interval.p99_us,
+               core1_stats.touch_scan_interval.max_us);
+    }
+    if (core1_stats.auth_sign_us) {
+        printf("PS4 auth last signature: %" PRIu32 " us\n", core1_stats.auth_sign_us);
+    }
+
+    const auto touch_age = core0_stats.touch_age.getSummary();
+    const auto usb_task_interval = core0_stats.usb_task_interval.getSummary();
+    printf("Touch on core%d frames: %" PRIu32 " age p50/p99/max: %" PRIu32 "/%" PRIu32 "/%" PRIu32
+           " us | USB task interval p50/p99/max: %" PRIu32 "/%" PRIu32 "/%" PRIu32 " us\n",
+           DIVACON_TOUCH_ON_CORE1 ? 1 : 0, core0_stats.touch_frames, touch_age.p50_us, touch_age.p99_us,
+           touch_age.max_us, usb_task_interval.p50_us, usb_task_interval.p99_us, usb_task_interval.max_us);
+    core0_stats.touch_age.reset();
+    core0_stats.usb_task_interval.reset();
+    core0_stats.touch_frames = 0;
+
+    if (mode_switch_timing.duration_us) {
+        printf("Last USB mode switch: %" PRIu32 " ms to first report\n", mode_switch_timing.duration_us / 1000);
+    }
+
+    if (settings_store.getFlashOperations()) {
+        printf("Settings flash operations: %" PRIu32 " longest stall: %" PRIu32 " us USB gap: %" PRIu32 " us\n",
+               settings_store.getFlashOperations(), settings_store.getLongestStall(), core0_stats.flash_usb_gap_us);
+    }
+
+    const auto age = input_phase_lock.getAgeSummary();
+    if (age.count) {
+        printf("Input age samples: %" PRIu32 " p50/p90/p99/max: %" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32
+               " us scan: %" PRIu32 " us\n",
+               age.count, age.p50_us, age.p90_us, age.p99_us, age.max_us, input_phase_lock.getScanEstimate());
+    }
+
+#if DIVACON_XIP_STATS
+    printf("XIP cache hit %%/misses:");
+    for (size_t idx = 0; idx < static_cast<size_t>(Utils::XipStats::Phase::Count); ++idx) {
+        const auto phase = static_cast<Utils::XipStats::Phase>(idx);
+        const auto &counters = Utils::XipStats::get(phase);
+
+        printf(" %s %" PRIu32 "/%" PRIu32, Utils::XipStats::getName(phase),
+               counters.accesses ? static_cast<uint32_t>(uint64_t(counters.hits) * 100 / counters.accesses) : 100,
+               counters.accesses - counters.hits);
+    }
+    printf("\n");
+    Utils::XipStats::reset();
+#endif
+}
+
+#if DIVACON_LATENCY_PROBES
+static void publishLatency(usb_mode_t mode) {
+    static const uint32_t interval_ms = 1000;
+    static uint32_t last_publish = 0;
+
+    const uint32_t now = to_ms_since_boot(get_absolute_time());
+    if (now - last_publish < interval_ms) {
+        return;
+    }
+    last_publish = now;
+
+    if (mode == USB_MODE_DEBUG) {
+        printf("Latency p50/p90/p99/max us:");
+        for (size_t idx = 0; idx < static_cast<size_t>(Utils::LatencyProbes::Span::Count); ++idx) {
+            const auto span = static_cast<Utils::LatencyProbes::Span>(idx);
+            const auto summary = Utils::LatencyProbes::getSummary(span);
+
+            printf(" %s %" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32, Utils::LatencyProbes::getName(span),
+                   summary.p50_us, summary.p90_us, summary.p99_us, summary.max_us);
+        }
+        printf("\n");
+    }
+
+    sendControl(ControlMessage{ControlCommand::SetLatency,
+                               {.latency = Utils::LatencyProbes::getSummary(Utils::LatencyProbes::Span::Total)}});
+
+    Utils::LatencyProbes::reset();
+}
+#endif
+
 void core1_task() {
+    static const uint32_t display_interval_us = 20000; // Limit to ~50fps
+    static const uint32_t stats_interval_us = 1000000;
+    static const uint32_t auth_slice_us = 1000;
+    static const uint32_t auth_slice_deadline_us = 100000;
+#if DIVACON_TOUCH_ON_CORE1
+    static const uint32_t touch_interval_us = 1000;
+#endif
+
     multicore_lockout_victim_init();
+    core1_doorbell.initConsumer();
+
+    // Too large for the core1 stack.
+    static Peripherals::Display display(Config::Default::display_config);
+    static Peripherals::TouchSliderLeds sliderleds(Config::Default::touch_slider_leds_config);
+    static Utils::PS4AuthProvider ps4authprovider;
+    static Utils::Scheduler scheduler([]() { return time_us_32(); });
 
-    Peripherals::Display display(Config::Default::display_config);
-    Peripherals::TouchSliderLeds sliderleds(Config::Default::touch_slider_leds_config);
     Peripherals::ButtonLeds buttonleds(Config::Default::button_leds_config,
                                        Config::Default::touch_slider_leds_config.enable_pdloader_support);
 
-    Utils::PS4AuthProvider ps4authprovider;
-    std::array<uint8_t, Utils::PS4AuthProvider::SIGNATURE_LENGTH> auth_challenge;
+    AuthChallenge auth_challenge;
+    bool auth_challenge_pending = false;
+    uint32_t auth_started_us = 0;
+    uint32_t auth_sign_us = 0;
 
     ControlMessage control_msg;
+    SettingsMessage settings_msg;
+    SettingsMessage applied_settings;
+    bool settings_applied = false;
     Utils::Menu::State menu_display_msg;
     Utils::InputState::InputMessage input_msg;
-    Peripherals::TouchSliderLeds::RawFrameMessage slider_led_msg;
+    bool slider_led_msg_pending = false;
+
+    Utils::LatencyHistogram wake_latency(25);
+
+    // Released once per animation frame, the LEDs keep their own frame grid. A frame is only dropped if the release
+    // is held back by half an interval, 4 ms at 120 fps. No other task runs that long: the display skips drawing
+    // while its previous frame is still sent and the auth slices are 1 ms. Dropped frames show up in the slider LED
+    // frame stats.
+    const uint32_t slider_leds_interval_us = sliderleds.getFrameInterval();
+    const auto slider_leds_task = scheduler.addTask(
+        {"leds", slider_leds_interval_us, slider_leds_interval_us, 2}, [&](uint32_t now_us) {
+            if (slider_led_msg_pending) {
+                sliderleds.update(led_frames.getFront());
+                slider_led_msg_pending = false;
+            } else {
+                sliderleds.update(now_us);
+            }
+        });
+
+    // Signing takes far longer than a LED frame, so it is done in slices which reschedule themselves. A slice runs
+    // over auth_slice_us by at most one ModExp step, the max runtime of "auth" in the debug telemetry shows by how much.
+    Utils::Scheduler::TaskId auth_task = 0;
+    auth_task = scheduler.addTask({"auth", 0, auth_slice_deadline_us, 0}, [&](uint32_t now_us) {
+        if (auth_challenge_pending) {
+            auth_challenge_pending = false;
+            auth_started_us = now_us;
+
+            if (!ps4authprovider.begin(auth_challenge)) {
+                auth_handshake.respond(std::nullopt);
+                return;
+            }
+        }
 
-    while (true) {
-        if (queue_try_remove(&control_queue, &control_msg)) {
+        if (ps4authprovider.step(auth_slice_us)) {
+            auth_handshake.respond(ps4authprovider.getSignature());
+            auth_sign_us = time_us_32() - auth_started_us;
+        } else {
+            scheduler.trigger(auth_task);
+        }
+    });
+
+    const auto events_task = scheduler.addTask({"events", 0, 1000, 3}, [&](uint32_t) {
+        if (settings_mailbox.tryTake(settings_msg)) {
+            // Only apply what actually changed since the last snapshot.
+            const auto changed = [&](auto SettingsMessage::*field) {
+                return !settings_applied || settings_msg.*field != applied_settings.*field;
+            };
+
+            if (changed(&SettingsMessage::usb_mode)) {
+                display.setUsbMode(settings_msg.usb_mode);
+            }
+            if (changed(&SettingsMessage::led_brightness)) {
+                sliderleds.setBrightness(settings_msg.led_brightness);
+                buttonleds.setBrightness(settings_msg.led_brightness);
+            }
+            if (changed(&SettingsMessage::led_animation_speed)) {
+                sliderleds.setAnimationSpeed(settings_msg.led_animation_speed);
+            }
+            if (changed(&SettingsMessage::led_idle_mode)) {
+                sliderleds.setIdleMode(settings_msg.led_idle_mode);
+            }
+            if (changed(&SettingsMessage::led_touched_mode)) {
+                sliderleds.setTouchedMode(settings_msg.led_touched_mode);
+            }
+            if (changed(&SettingsMessage::led_idle_color)) {
+                sliderleds.setIdleColor(settings_msg.led_idle_color);
+            }
+            if (changed(&SettingsMessage::led_touched_color)) {
+                sliderleds.setTouchedColor(settings_msg.led_touched_color);
+            }
+            if (changed(&SettingsMessage::led_enable_player_color)) {
+                sliderleds.setEnablePlayerColor(settings_msg.led_enable_player_color);
+            }
+            if (changed(&SettingsMessage::led_enable_pdloader_support)) {
+                sliderleds.setEnablePdloaderSupport(settings_msg.led_enable_pdloader_support);
+                buttonleds.setEnablePdloaderSupport(settings_msg.led_enable_pdloader_support);
+                buttonleds.update();
+            }
+
+            applied_settings = settings_msg;
+            settings_applied = true;
+        }
+        while (control_ring.tryPop(control_msg)) {
             switch (control_msg.command) {
-            case ControlCommand::SetUsbMode:
-                display.setUsbMode(control_msg.data.usb_mode);
-                break;
             case ControlCommand::SetPlayerLed:
                 switch (control_msg.data.player_led.type) {
                 case USB_PLAYER_LED_ID:
@@ -98,30 +455,8 @@ void core1_task() {
             case ControlCommand::SetButtonLed:
                 buttonleds.update(control_msg.data.button_led);
                 break;
-            case ControlCommand::SetLedBrightness:
-                sliderleds.setBrightness(control_msg.data.led_brightness);
-                break;
-            case ControlCommand::SetLedAnimationSpeed:
-                sliderleds.setAnimationSpeed(control_msg.data.led_animation_speed);
-                break;
-            case ControlCommand::SetLedIdleMode:
-                sliderleds.setIdleMode(control_msg.data.led_idle_mode);
-                break;
-            case ControlCommand::SetLedTouchedMode:
-                sliderleds.setTouchedMode(control_msg.data.led_touched_mode);
-                break;
-            case ControlCommand::SetLedIdleColor:
-                sliderleds.setIdleColor(control_msg.data.led_idle_color);
-                break;
-            case ControlCommand::SetLedTouchedColor:
-                sliderleds.setTouchedColor(control_msg.data.led_touched_color);
-                break;
-            case ControlCommand::SetLedEnablePlayerColor:
-                sliderleds.setEnablePlayerColor(control_msg.data.led_enable_player_color);
-                break;
-            case ControlCommand::SetLedEnablePdloaderSupport:
-                sliderleds.setEnablePdloaderSupport(control_msg.data.led_enable_pdloader_support);
-                buttonleds.setEnablePdloaderSupport(control_msg.data.led_enable_pdloader_support);
+            case ControlCommand::SetLatency:
+                display.setLatency(control_msg.data.latency);
                 break;
             case ControlCommand::EnterMenu:
                 display.showMenu();
@@ -131,140 +466,229 @@ void core1_task() {
                 break;
             }
         }
-        if (queue_try_remove(&input_queue, &input_msg)) {
+        if (input_mailbox.tryTake(input_msg)) {
             sliderleds.setTouched(input_msg.touches);
             buttonleds.setButtons(input_msg.buttons);
+            buttonleds.update();
             display.setTouched(input_msg.touches);
             display.setButtons(input_msg.buttons);
+
+            // Show touch feedback right away instead of waiting for the next frame.
+            scheduler.trigger(slider_leds_task);
         }
-        if (queue_try_remove(&led_queue, &slider_led_msg)) {
-            sliderleds.update(slider_led_msg);
-        } else {
-            sliderleds.update();
+        if (led_frames.tryAcquire()) {
+            slider_led_msg_pending = true;
+            scheduler.trigger(slider_leds_task);
         }
-        if (queue_try_remove(&menu_display_queue, &menu_display_msg)) {
+        if (menu_display_mailbox.tryTake(menu_display_msg)) {
             display.setMenuState(menu_display_msg);
         }
-        if (queue_try_remove(&auth_challenge_queue, auth_challenge.data())) {
-            const auto signed_challenge = ps4authprovider.sign(auth_challenge);
-            queue_try_remove(&auth_signed_challenge_queue, nullptr); // clear queue first
-            queue_try_add(&auth_signed_challenge_queue, &signed_challenge);
+        if (auth_handshake.tryTakeRequest(auth_challenge)) {
+            // Restarts a signature still in progress, its challenge has been superseded.
+            auth_challenge_pending = true;
+            scheduler.trigger(auth_task);
         }
+    });
 
-        buttonleds.update();
-        display.update();
+#if DIVACON_TOUCH_ON_CORE1
+    // Shares core1 with the other tasks, the scan intervals show how far they hold it back.
+    Utils::LatencyHistogram touch_scan_interval(50);
+    uint32_t touch_last_scan_us = 0;
+    scheduler.addTask({"touch", touch_interval_us, touch_interval_us, 4}, [&](uint32_t now_us) {
+        if (touch_last_scan_us) {
+            touch_scan_interval.add(now_us - touch_last_scan_us);
+        }
+        touch_last_scan_us = now_us;
 
-        sleep_ms(1);
+        touch_frame_mailbox.post({core1_touch_slider->scan(), now_us});
+    });
+#endif
+
+    scheduler.addTask({"display", display_interval_us, display_interval_us, 1}, [&](uint32_t) { display.update(); });
+
+    scheduler.addTask({"stats", stats_interval_us, stats_interval_us, 0}, [&](uint32_t) {
+        Core1Stats stats = {};
+
+        stats.wake = wake_latency.getSummary();
+        stats.auth_sign_us = auth_sign_us;
+        stats.task_count = scheduler.getTaskCount();
+        for (size_t id = 0; id < stats.task_count; ++id) {
+            stats.tasks[id] = scheduler.getStats(id);
+        }
+        stats.slider_led_frames = sliderleds.getFrameStats();
+        stats.slider_led_raw_latency = sliderleds.getRawFrameLatency();
+        stats.slider_led_frame_time = sliderleds.getFrameTime();
+        stats.slider_led_frame_jitter = sliderleds.getFrameJitter();
+#if DIVACON_TOUCH_ON_CORE1
+        stats.touch_scan_interval = touch_scan_interval.getSummary();
+        touch_scan_interval.reset();
+#endif
+        core1_stats_mailbox.post(stats);
+
+        wake_latency.reset();
+        scheduler.resetStats();
+        sliderleds.resetFrameStats();
+    });
+
+    while (true) {
+        uint32_t rung_us;
+        if (core1_doorbell.take(rung_us)) {
+            wake_latency.add(time_us_32() - rung_us);
+            scheduler.trigger(events_task);
+        }
+
+        if (!scheduler.runNext()) {
+            core1_doorbell.wait(make_timeout_time_us(scheduler.getIdleTime()));
+        }
     }
 }
 
 int main() {
-    queue_init(&control_queue, sizeof(ControlMessage), 1);
-    queue_init(&menu_display_queue, sizeof(Utils::Menu::State), 1);
-    queue_init(&input_queue, sizeof(Utils::InputState::InputMessage), 1);
-    queue_init(&led_queue, sizeof(Peripherals::TouchSliderLeds::RawFrameMessage), 1);
-    queue_init(&auth_challenge_queue, sizeof(std::array<uint8_t, Utils::PS4AuthProvider::SIGNATURE_LENGTH>), 1);
-    queue_init(&auth_signed_challenge_queue, sizeof(std::array<uint8_t, Utils::PS4AuthProvider::SIGNATURE_LENGTH>), 1);
+    mbedtls_memory_buffer_alloc_init(mbedtls_arena, sizeof(mbedtls_arena));
 
     Utils::InputState input_state;
-    std::array<uint8_t, Utils::PS4AuthProvider::SIGNATURE_LENGTH> auth_challenge_response;
+    Core0Stats core0_stats;
+    static Utils::InputPhaseLock input_phase_lock(Config::Default::input_phase_lock_config);
+    std::optional<AuthChallenge> auth_challenge_response;
 
-    auto settings_store = std::make_shared<Utils::SettingsStore>();
+    static Utils::SettingsStore settings_store;
     Utils::Menu menu(settings_store);
 
-    const auto mode = settings_store->getUsbMode();
+    usb_mode_t mode = settings_store.getUsbMode();
 
     Peripherals::TouchSlider touch_slider(Config::Default::touch_slider_config, mode);
     Peripherals::Buttons buttons(Config::Default::buttons_config);
 
+#if DIVACON_TOUCH_ON_CORE1
+    core1_touch_slider = &touch_slider;
+    TouchFrameMessage touch_frame = {0, time_us_32()};
+#endif
+
+    // Parses the key with mbedtls, which belongs to core1 once it is launched.
+    if (Config::PS4Auth::config.enabled) {
+        ps4_auth_init(Config::PS4Auth::config.key_pem, strlen(Config::PS4Auth::config.key_pem) + 1,
+                      Config::PS4Auth::config.serial.data(), Config::PS4Auth::config.signature.data(),
+                      [](const uint8_t *challenge) {
+                          AuthChallenge request;
+                          std::copy_n(challenge, request.size(), request.begin());
+                          auth_handshake.request(request);
+                          core1_doorbell.ring();
+                      });
+    }
+
     multicore_launch_core1(core1_task);
 
+    // When phase locked, sampling is delayed instead and the report should go out right away.
+    usbd_driver_set_send_offset(input_phase_lock.enabled() ? 0 : Config::Default::usb_report_send_offset_us);
+    usbd_driver_set_poll_interval(settings_store.getUsbPollInterval(mode));
     usbd_driver_init(mode);
+    usbd_driver_set_report_complete_cb([]() {
+        if (mode_switch_timing.pending) {
+            mode_switch_timing.duration_us = time_us_32() - mode_switch_timing.started_us;
+            mode_switch_timing.pending = false;
+        }
+        LATENCY_PROBE(TransferComplete);
+        input_phase_lock.reportCompleted();
+    });
     usbd_driver_set_player_led_cb([](usb_player_led_t player_led) {
-        const auto ctrl_message = ControlMessage{ControlCommand::SetPlayerLed, {.player_led = player_led}};
-        queue_try_add(&control_queue, &ctrl_message);
+        sendControl(ControlMessage{ControlCommand::SetPlayerLed, {.player_led = player_led}});
     });
     usbd_driver_set_button_led_cb([](usb_button_led_t button_led) {
-        const auto ctrl_message = ControlMessage{ControlCommand::SetButtonLed, {.button_led = button_led}};
-        queue_try_add(&control_queue, &ctrl_message);
+        sendControl(ControlMessage{ControlCommand::SetButtonLed, {.button_led = button_led}});
     });
     usbd_driver_set_slider_led_cb([](const uint8_t *frame, size_t len) {
-        auto led_message = Peripherals::TouchSliderLeds::RawFrameMessage();
-
-        // Colors in `frame` 3 byte in the order: Green, Red, Blue from right
-        // to left (so we need to reverse the order).
-        for (size_t color_idx = 0; color_idx < len / 3; ++color_idx) {
-            if (color_idx >= led_message.size()) {
-                break;
-            }
+        // Decoded on core1 straight into the LED frame, the buffer is handed over without copying it again.
+        auto &led_message = led_frames.getBack();
 
-            led_message[led_message.size() - 1 - color_idx] =
-                Peripherals::TouchSliderLeds::TouchSliderLeds::Config::Color{
-                    .r = frame[color_idx * 3 + 1],
-                    .g = frame[color_idx * 3],
-                    .b = frame[color_idx * 3 + 2],
-                };
-        }
+        std::copy_n(frame, std::min(len, led_message.grb.size()), led_message.grb.begin());
+        led_message.received_us = time_us_32();
 
-        queue_try_add(&led_queue, &led_message);
+        led_frames.publish();
+        core1_doorbell.ring();
     });
 
-    if (Config::PS4Auth::config.enabled) {
-        ps4_auth_init(Config::PS4Auth::config.key_pem.c_str(), Config::PS4Auth::config.key_pem.size() + 1,
-                      Config::PS4Auth::config.serial.data(), Config::PS4Auth::config.signature.data(),
-                      [](const uint8_t *challenge) { queue_try_add(&auth_challenge_queue, challenge); });
-    }
 
     stdio_init_all();
 
+    // Cheap enough to be called every loop iteration, core1 is only notified when something changed.
+    std::optional<SettingsMessage> published_settings;
     const auto readSettings = [&]() {
-        buttons.setMirrorToDpad(settings_store->getInputMirrorToDpad());
-
-        ControlMessage ctrl_message;
-
-        ctrl_message = {ControlCommand::SetUsbMode, {.usb_mode = mode}};
-        queue_add_blocking(&control_queue, &ctrl_message);
-
-        ctrl_message = {ControlCommand::SetLedBrightness, {.led_brightness = settings_store->getLedBrightness()}};
-        queue_add_blocking(&control_queue, &ctrl_message);
-        ctrl_message = {ControlCommand::SetLedAnimationSpeed,
-                        {.led_animation_speed = settings_store->getLedAnimationSpeed()}};
-        queue_add_blocking(&control_queue, &ctrl_message);
-        ctrl_message = {ControlCommand::SetLedIdleMode, {.led_idle_mode = settings_store->getLedIdleMode()}};
-        queue_add_blocking(&control_queue, &ctrl_message);
-        ctrl_message = {ControlCommand::SetLedTouchedMode, {.led_touched_mode = settings_store->getLedTouchedMode()}};
-        queue_add_blocking(&control_queue, &ctrl_message);
-        ctrl_message = {ControlCommand::SetLedIdleColor, {.led_idle_color = settings_store->getLedIdleColor()}};
-        queue_add_blocking(&control_queue, &ctrl_message);
-        ctrl_message = {ControlCommand::SetLedTouchedColor,
-                        {.led_touched_color = settings_store->getLedTouchedColor()}};
-        queue_add_blocking(&control_queue, &ctrl_message);
-        ctrl_message = {ControlCommand::SetLedEnablePlayerColor,
-                        {.led_enable_player_color = settings_store->getLedEnablePlayerColor()}};
-        queue_add_blocking(&control_queue, &ctrl_message);
-        ctrl_message = {ControlCommand::SetLedEnablePdloaderSupport,
-                        {.led_enable_pdloader_support = settings_store->getLedEnablePdloaderSupport()}};
-        queue_add_blocking(&control_queue, &ctrl_message);
+        buttons.setMirrorToDpad(settings_store.getInputMirrorToDpad());
+
+        const SettingsMessage settings = {
+            mode,
+            settings_store.getLedBrightness(),
+            settings_store.getLedAnimationSpeed(),
+            settings_store.getLedIdleMode(),
+            settings_store.getLedTouchedMode(),
+            settings_store.getLedIdleColor(),
+            settings_store.getLedTouchedColor(),
+            settings_store.getLedEnablePlayerColor(),
+            settings_store.getLedEnablePdloaderSupport(),
+        };
+
+        if (published_settings != settings) {
+            settings_mailbox.post(settings);
+            published_settings = settings;
+            core1_doorbell.ring();
+        }
     };
 
     readSettings();
 
+    std::optional<Utils::InputState::InputMessage> published_input;
+    uint32_t last_usb_task_us = time_us_32();
+    uint32_t last_input_change_ms = to_ms_since_boot(get_absolute_time());
+    bool flash_accessed = false;
+
     while (true) {
+        input_phase_lock.waitForSampleWindow();
+        XIP_STATS_MARK(Wait);
+
+        input_phase_lock.beginSample();
         buttons.updateInputState(input_state);
+#if DIVACON_TOUCH_ON_CORE1
+        if (touch_frame_mailbox.tryTake(touch_frame)) {
+            core0_stats.touch_frames++;
+        }
+        touch_slider.updateInputState(input_state, touch_frame.touched);
+        core0_stats.touch_age.add(time_us_32() - touch_frame.scanned_us);
+#else
+        const uint32_t touch_scan_start = time_us_32();
         touch_slider.updateInputState(input_state);
+        core0_stats.touch_frames++;
+        core0_stats.touch_age.add(time_us_32() - touch_scan_start);
+#endif
+        LATENCY_PROBE(TouchFrame);
+        input_phase_lock.endSample();
+        XIP_STATS_MARK(Sample);
 
         const auto input_message = input_state.getInputMessage();
 
         if (menu.active()) {
             menu.update(input_state);
             if (menu.active()) {
-                const auto display_msg = menu.getState();
-                queue_add_blocking(&menu_display_queue, &display_msg);
+                menu_display_mailbox.post(menu.getState());
+                core1_doorbell.ring();
             } else {
-                settings_store->store();
+                settings_store.store();
+
+                // Re-enumerate in place instead of rebooting if the USB configuration changed.
+                const auto new_mode = settings_store.getUsbMode();
+                const auto new_poll_interval = settings_store.getUsbPollInterval(new_mode);
+                if (new_mode != mode || new_poll_interval != usbd_driver_get_poll_interval()) {
+                    mode = new_mode;
+                    mode_switch_timing.started_us = time_us_32();
+                    mode_switch_timing.pending = true;
 
-                ControlMessage ctrl_message = {ControlCommand::ExitMenu, {}};
-                queue_add_blocking(&control_queue, &ctrl_message);
+                    usbd_driver_set_poll_interval(new_poll_interval);
+                    usbd_driver_switch_mode(mode);
+
+                    touch_slider.setMode(mode);
+                    input_state = Utils::InputState();
+                }
+
+                sendControl({ControlCommand::ExitMenu, {}});
             }
 
             readSettings();
@@ -273,18 +697,54 @@ int main() {
         } else if (input_state.checkHotkey()) {
             menu.activate();
 
-            ControlMessage ctrl_message{ControlCommand::EnterMenu, {}};
-            queue_add_blocking(&control_queue, &ctrl_message);
+            sendControl({ControlCommand::EnterMenu, {}});
         }
 
-        usbd_driver_send_report(input_state.getReport(mode));
+        XIP_STATS_MARK(Menu);
+
+        const auto report = input_state.getReport(mode);
+        LATENCY_PROBE(ReportBuilt);
+
+        if (usbd_driver_send_report(report)) {
+            LATENCY_PROBE(ReportSubmitted);
+            input_phase_lock.reportSubmitted();
+        }
+        XIP_STATS_MARK(Report);
+
         usbd_driver_task();
 
-        queue_try_add(&input_queue, &input_message);
+        const uint32_t usb_task_us = time_us_32();
+        core0_stats.usb_task_interval.add(usb_task_us - last_usb_task_us);
+        if (flash_accessed) {
+            core0_stats.flash_usb_gap_us = std::max(core0_stats.flash_usb_gap_us, usb_task_us - last_usb_task_us);
+        }
+        last_usb_task_us = usb_task_us;
+
+        // Settings are written while nobody is playing, right after the report has been queued.
+        const uint32_t input_idle_ms = usbd_driver_is_polled()
+                                           ? to_ms_since_boot(get_absolute_time()) - last_input_change_ms
+                                           : std::numeric_limits<uint32_t>::max();
+        flash_accessed = settings_store.task(input_idle_ms);
+        XIP_STATS_MARK(Usb);
+
+        if (mode == USB_MODE_DEBUG) {
+            printTelemetry(input_phase_lock, core0_stats, settings_store);
+        }
+#if DIVACON_LATENCY_PROBES
+        publishLatency(mode);
+#endif
+
+        if (published_input != input_message) {
+            input_mailbox.post(input_message);
+            published_input = input_message;
+            last_input_change_ms = to_ms_since_boot(get_absolute_time());
+            core1_doorbell.ring();
+        }
 
-        if (queue_try_remove(&auth_signed_challenge_queue, auth_challenge_response.data())) {
-            ps4_auth_set_signed_challenge(auth_challenge_response.data());
+        if (auth_handshake.tryGetResponse(auth_challenge_response) && auth_challenge_response) {
+            ps4_auth_set_signed_challenge(auth_challenge_response->data());
         }
+        XIP_STATS_MARK(Other);
     }
 
     return 0;
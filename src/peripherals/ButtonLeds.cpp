@@ -1,34 +1,173 @@
 #include "peripherals/ButtonLeds.h"
 
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
 #include "hardware/gpio.h"
+#include "hardware/pwm.h"
+
+#include <algorithm>
 
 namespace Divacon::Peripherals {
 
+namespace {
+
+// Levels are squared for a more even perceived brightness, a full level keeps the output on.
+const uint32_t pwm_period = 255 * 255;
+const uint16_t pacing_clkdiv = 255;
+
+uint32_t to_duty(uint8_t level) { return level * level; }
+
+} // namespace
+
 ButtonLeds::ButtonLeds(const Config &config, bool enable_pdloader_support)
-    : m_config(config), m_enable_pdloader_support(enable_pdloader_support), m_buttons({}), m_raw_mode(false) {
-    uint button_mask = 0                          //
-                       | 1 << m_config.pins.north //
-                       | 1 << m_config.pins.east  //
-                       | 1 << m_config.pins.south //
-                       | 1 << m_config.pins.west;
-
-    gpio_init_mask(button_mask);
-    gpio_set_dir_out_masked(button_mask);
+    : m_config(config), m_enable_pdloader_support(enable_pdloader_support), m_brightness(UINT8_MAX), m_buttons({}),
+      m_raw_mode(false), m_leds({}), m_slices({}), m_slice_count(0) {
+    const std::array<uint8_t, LED_COUNT> pins = {m_config.pins.north, m_config.pins.east, m_config.pins.south,
+                                                 m_config.pins.west};
+
+    uint32_t used_slices = 0;
+    for (size_t idx = 0; idx < LED_COUNT; ++idx) {
+        const uint slice_number = pwm_gpio_to_slice_num(pins[idx]);
+        if (!(used_slices & (1u << slice_number))) {
+            m_slices[m_slice_count++].number = slice_number;
+            used_slices |= 1u << slice_number;
+        }
+
+        auto &led = m_leds[idx];
+        led.slice = std::find_if(m_slices.begin(), m_slices.end(),
+                                 [&](const Slice &slice) { return slice.number == slice_number; }) -
+                    m_slices.begin();
+        led.channel = pwm_gpio_to_channel(pins[idx]);
+
+        gpio_set_function(pins[idx], GPIO_FUNC_PWM);
+    }
+
+    // Fade steps are clocked by the wrap of the first slice without a button LED.
+    uint pacing_slice = 0;
+    while (used_slices & (1u << pacing_slice)) {
+        ++pacing_slice;
+    }
+
+    const uint32_t pacing_period = clock_get_hz(clk_sys) / pacing_clkdiv / 1000 * m_config.fade_ms / FADE_STEPS;
+
+    pwm_config pacing_config = pwm_get_default_config();
+    pwm_config_set_clkdiv_int(&pacing_config, pacing_clkdiv);
+    pwm_config_set_wrap(&pacing_config, std::clamp<uint32_t>(pacing_period, 1, UINT16_MAX + 1) - 1);
+    pwm_init(pacing_slice, &pacing_config, true);
+
+    for (size_t idx = 0; idx < m_slice_count; ++idx) {
+        auto &slice = m_slices[idx];
+
+        // Outputs are active low unless inverted.
+        pwm_config slice_config = pwm_get_default_config();
+        pwm_config_set_wrap(&slice_config, pwm_period - 1);
+        pwm_config_set_output_polarity(&slice_config, !m_config.invert, !m_config.invert);
+        pwm_init(slice.number, &slice_config, true);
+
+        slice.dma_channel = dma_claim_unused_channel(true);
+
+        dma_channel_config dma_config = dma_channel_get_default_config(slice.dma_channel);
+        channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
+        channel_config_set_read_increment(&dma_config, true);
+        channel_config_set_write_increment(&dma_config, false);
+        channel_config_set_dreq(&dma_config, pwm_get_dreq(pacing_slice));
+        dma_channel_configure(slice.dma_channel, &dma_config, &pwm_hw->slice[slice.number].cc,
+                              slice.fade_table.data(), 0, false);
+    }
 }
 
 void ButtonLeds::setEnablePdloaderSupport(bool do_enable) { m_enable_pdloader_support = do_enable; }
 
+void ButtonLeds::setBrightness(uint8_t brightness) {
+    m_brightness = brightness;
+
+    std::array<bool, LED_COUNT> lit;
+    std::transform(m_leds.begin(), m_leds.end(), lit.begin(), [](const Led &led) { return led.lit; });
+
+    show(lit, true, true);
+}
+
 void ButtonLeds::setButtons(const Utils::InputState::Buttons &buttons) { m_buttons = buttons; }
 
+uint8_t ButtonLeds::getFadeLevel(const Led &led, uint32_t position) {
+    if (position >= FADE_STEPS) {
+        return 0;
+    }
+
+    return led.fade_from * (FADE_STEPS - position) / FADE_STEPS;
+}
+
+// Rebuilds the level table of every slice with a changed LED and restarts its DMA, fades which are already running
+// continue where they were.
+void ButtonLeds::show(const std::array<bool, LED_COUNT> &lit, bool fade, bool force) {
+    for (size_t slice_idx = 0; slice_idx < m_slice_count; ++slice_idx) {
+        auto &slice = m_slices[slice_idx];
+
+        bool changed = force;
+        for (size_t idx = 0; idx < LED_COUNT; ++idx) {
+            changed |= m_leds[idx].slice == slice_idx && m_leds[idx].lit != lit[idx];
+        }
+        if (!changed) {
+            continue;
+        }
+
+        dma_channel_abort(slice.dma_channel);
+        const uint32_t played = slice.fade_length - dma_channel_hw_addr(slice.dma_channel)->transfer_count;
+
+        uint32_t length = 1;
+        for (size_t idx = 0; idx < LED_COUNT; ++idx) {
+            auto &led = m_leds[idx];
+            if (led.slice != slice_idx) {
+                continue;
+            }
+
+            if (led.lit && !lit[idx] && fade && m_config.fade_ms > 0) {
+                led.fading = true;
+                led.fade_from = m_brightness;
+                led.fade_position = 0;
+            } else if (lit[idx] || !fade) {
+                led.fading = false;
+            } else if (led.fading) {
+                // Continue from the entry currently shown.
+                led.fade_position = std::min<uint32_t>(led.fade_position + played - 1, FADE_STEPS);
+                led.fading = led.fade_position < FADE_STEPS;
+            }
+            led.lit = lit[idx];
+
+            if (led.fading) {
+                length = std::max<uint32_t>(length, FADE_STEPS + 1 - led.fade_position);
+            }
+        }
+
+        for (uint32_t step = 0; step < length; ++step) {
+            uint32_t levels = 0;
+            for (const auto &led : m_leds) {
+                if (led.slice != slice_idx) {
+                    continue;
+                }
+
+                const uint8_t level =
+                    led.lit ? m_brightness : (led.fading ? getFadeLevel(led, led.fade_position + step) : 0);
+                levels |= to_duty(level) << (led.channel == PWM_CHAN_B ? PWM_CH0_CC_B_LSB : PWM_CH0_CC_A_LSB);
+            }
+            slice.fade_table[step] = levels;
+        }
+
+        // The first step is applied right away, the slice picks it up at its next wrap.
+        pwm_hw->slice[slice.number].cc = slice.fade_table[0];
+        slice.fade_length = length;
+        if (length > 1) {
+            dma_channel_transfer_from_buffer_now(slice.dma_channel, &slice.fade_table[1], length - 1);
+        }
+    }
+}
+
 void ButtonLeds::update() {
     if (m_raw_mode && m_enable_pdloader_support) {
         return;
     }
 
-    gpio_put(m_config.pins.north, !(m_config.invert ^ m_buttons.north));
-    gpio_put(m_config.pins.east, !(m_config.invert ^ m_buttons.east));
-    gpio_put(m_config.pins.south, !(m_config.invert ^ m_buttons.south));
-    gpio_put(m_config.pins.west, !(m_config.invert ^ m_buttons.west));
+    show({m_buttons.north, m_buttons.east, m_buttons.south, m_buttons.west}, true, false);
 }
 
 void ButtonLeds::update(const usb_button_led_t &raw) {
@@ -38,10 +177,8 @@ void ButtonLeds::update(const usb_button_led_t &raw) {
 
     m_raw_mode = true;
 
-    gpio_put(m_config.pins.north, m_config.invert ^ raw.north);
-    gpio_put(m_config.pins.east, m_config.invert ^ raw.east);
-    gpio_put(m_config.pins.south, m_config.invert ^ raw.south);
-    gpio_put(m_config.pins.west, m_config.invert ^ raw.west);
+    // PDLoader sends the pin levels of active low LEDs, the host does its own fading.
+    show({!raw.north, !raw.east, !raw.south, !raw.west}, false, false);
 }
 
 } // namespace Divacon::Peripherals
@@ -1,5 +1,7 @@
 #include "peripherals/Buttons.h"
 
+#include "utils/HotPath.h"
+
 #include "hardware/gpio.h"
 #include "pico/time.h"
 
@@ -7,20 +9,34 @@ namespace Divacon::Peripherals {
 
 Buttons::Button::Button(uint8_t pin) : gpio_pin(pin), gpio_mask(1 << pin), last_change(0), active(false) {}
 
-void Buttons::Button::setState(bool state, uint8_t debounce_delay) {
+void DIVACON_HOT_PATH Buttons::Button::setState(bool state, uint8_t debounce_delay) {
     if (active == state) {
+#if DIVACON_LATENCY_PROBES
+        pending_since_us = 0;
+#endif
         return;
     }
 
+#if DIVACON_LATENCY_PROBES
+    if (pending_since_us == 0) {
+        pending_since_us = time_us_32();
+    }
+#endif
+
     // Immediately change the input state, but only allow a change every debounce_delay milliseconds.
     uint32_t now = to_ms_since_boot(get_absolute_time());
     if (last_change + debounce_delay <= now) {
         active = state;
         last_change = now;
+
+#if DIVACON_LATENCY_PROBES
+        LATENCY_PROBE_SPAN(Debounce, time_us_32() - pending_since_us);
+        pending_since_us = 0;
+#endif
     }
 }
 
-void Buttons::socdClean(Utils::InputState &input_state) {
+void DIVACON_HOT_PATH Buttons::socdClean(Utils::InputState &input_state) {
 
     // Last input has priority
     if (input_state.dpad.up && input_state.dpad.down) {
@@ -48,64 +64,67 @@ void Buttons::socdClean(Utils::InputState &input_state) {
     }
 }
 
-Buttons::Buttons(const Config &config) : m_config(config), m_socd_state{Id::DOWN, Id::RIGHT} {
-    m_buttons.emplace(Id::UP, config.pins.dpad.up);
-    m_buttons.emplace(Id::DOWN, config.pins.dpad.down);
-    m_buttons.emplace(Id::LEFT, config.pins.dpad.left);
-    m_buttons.emplace(Id::RIGHT, config.pins.dpad.right);
-    m_buttons.emplace(Id::NORTH, config.pins.buttons.north);
-    m_buttons.emplace(Id::EAST, config.pins.buttons.east);
-    m_buttons.emplace(Id::SOUTH, config.pins.buttons.south);
-    m_buttons.emplace(Id::WEST, config.pins.buttons.west);
-    m_buttons.emplace(Id::L1, config.pins.buttons.l1);
-    m_buttons.emplace(Id::L2, config.pins.buttons.l2);
-    m_buttons.emplace(Id::L3, config.pins.buttons.l3);
-    m_buttons.emplace(Id::R1, config.pins.buttons.r1);
-    m_buttons.emplace(Id::R2, config.pins.buttons.r2);
-    m_buttons.emplace(Id::R3, config.pins.buttons.r3);
-    m_buttons.emplace(Id::START, config.pins.buttons.start);
-    m_buttons.emplace(Id::SELECT, config.pins.buttons.select);
-    m_buttons.emplace(Id::HOME, config.pins.buttons.home);
-
+Buttons::Buttons(const Config &config)
+    : m_config(config), m_socd_state{Id::DOWN, Id::RIGHT},
+      m_buttons({
+          config.pins.dpad.up,
+          config.pins.dpad.down,
+          config.pins.dpad.left,
+          config.pins.dpad.right,
+          config.pins.buttons.north,
+          config.pins.buttons.east,
+          config.pins.buttons.south,
+          config.pins.buttons.west,
+          config.pins.buttons.l1,
+          config.pins.buttons.l2,
+          config.pins.buttons.l3,
+          config.pins.buttons.r1,
+          config.pins.buttons.r2,
+          config.pins.buttons.r3,
+          config.pins.buttons.start,
+          config.pins.buttons.select,
+          config.pins.buttons.home,
+      }) {
     for (const auto &button : m_buttons) {
-        gpio_init(button.second.getGpioPin());
-        gpio_set_dir(button.second.getGpioPin(), GPIO_IN);
-        gpio_pull_up(button.second.getGpioPin());
+        gpio_init(button.getGpioPin());
+        gpio_set_dir(button.getGpioPin(), GPIO_IN);
+        gpio_pull_up(button.getGpioPin());
     }
 }
 
 void Buttons::setMirrorToDpad(bool mirror_to_dpad) { m_config.mirror_to_dpad = mirror_to_dpad; }
 
-void Buttons::updateInputState(Utils::InputState &input_state) {
+void DIVACON_HOT_PATH Buttons::updateInputState(Utils::InputState &input_state) {
     uint32_t gpio_state = ~gpio_get_all();
+    LATENCY_PROBE(GpioSample);
 
     for (auto &button : m_buttons) {
-        button.second.setState(gpio_state & button.second.getGpioMask(), m_config.debounce_delay_ms);
+        button.setState(gpio_state & button.getGpioMask(), m_config.debounce_delay_ms);
     }
 
-    input_state.dpad.up = m_buttons.at(Id::UP).getState();
-    input_state.dpad.down = m_buttons.at(Id::DOWN).getState();
-    input_state.dpad.left = m_buttons.at(Id::LEFT).getState();
-    input_state.dpad.right = m_buttons.at(Id::RIGHT).getState();
-    input_state.buttons.north = m_buttons.at(Id::NORTH).getState();
-    input_state.buttons.east = m_buttons.at(Id::EAST).getState();
-    input_state.buttons.south = m_buttons.at(Id::SOUTH).getState();
-    input_state.buttons.west = m_buttons.at(Id::WEST).getState();
-    input_state.buttons.l1 = m_buttons.at(Id::L1).getState();
-    input_state.buttons.l2 = m_buttons.at(Id::L2).getState();
-    input_state.buttons.l3 = m_buttons.at(Id::L3).getState();
-    input_state.buttons.r1 = m_buttons.at(Id::R1).getState();
-    input_state.buttons.r2 = m_buttons.at(Id::R2).getState();
-    input_state.buttons.r3 = m_buttons.at(Id::R3).getState();
-    input_state.buttons.start = m_buttons.at(Id::START).getState();
-    input_state.buttons.select = m_buttons.at(Id::SELECT).getState();
-    input_state.buttons.home = m_buttons.at(Id::HOME).getState();
+    input_state.dpad.up = getButton(Id::UP).getState();
+    input_state.dpad.down = getButton(Id::DOWN).getState();
+    input_state.dpad.left = getButton(Id::LEFT).getState();
+    input_state.dpad.right = getButton(Id::RIGHT).getState();
+    input_state.buttons.north = getButton(Id::NORTH).getState();
+    input_state.buttons.east = getButton(Id::EAST).getState();
+    input_state.buttons.south = getButton(Id::SOUTH).getState();
+    input_state.buttons.west = getButton(Id::WEST).getState();
+    input_state.buttons.l1 = getButton(Id::L1).getState();
+    input_state.buttons.l2 = getButton(Id::L2).getState();
+    input_state.buttons.l3 = getButton(Id::L3).getState();
+    input_state.buttons.r1 = getButton(Id::R1).getState();
+    input_state.buttons.r2 = getButton(Id::R2).getState();
+    input_state.buttons.r3 = getButton(Id::R3).getState();
+    input_state.buttons.start = getButton(Id::START).getState();
+    input_state.buttons.select = getButton(Id::SELECT).getState();
+    input_state.buttons.home = getButton(Id::HOME).getState();
 
     if (m_config.mirror_to_dpad) {
-        input_state.dpad.up |= m_buttons.at(Id::NORTH).getState();
-        input_state.dpad.down |= m_buttons.at(Id::SOUTH).getState();
-        input_state.dpad.left |= m_buttons.at(Id::WEST).getState();
-        input_state.dpad.right |= m_buttons.at(Id::EAST).getState();
+        input_state.dpad.up |= getButton(Id::NORTH).getState();
+        input_state.dpad.down |= getButton(Id::SOUTH).getState();
+        input_state.dpad.left |= getButton(Id::WEST).getState();
+        input_state.dpad.right |= getButton(Id::EAST).getState();
     }
 
     socdClean(input_state);
@@ -3,10 +3,12 @@
 #include "hardware/gpio.h"
 #include "pico/time.h"
 
+#include <algorithm>
 #include <array>
-#include <list>
+#include <inttypes.h>
 #include <numeric>
-#include <string>
+#include <stdio.h>
+#include <string.h>
 
 namespace Divacon::Peripherals {
 
@@ -138,7 +140,7 @@ static const std::array<uint8_t, 1154> menu_screen_top = {
 
 Display::Display(const Config &config)
     : m_config(config), m_state(State::Idle), m_touched(0), m_buttons({}), m_usb_mode(USB_MODE_DEBUG), m_player_id(0),
-      m_menu_state({Utils::Menu::Page::Main, 0, 0}) {
+      m_menu_state({Utils::Menu::Page::Main, 0, 0}), m_latency({}), m_buffer({}), m_dma_buffer({}) {
 
     i2c_init(m_config.i2c_block, m_config.i2c_speed_hz);
     gpio_set_function(m_config.sda_pin, GPIO_FUNC_I2C);
@@ -147,7 +149,8 @@ Display::Display(const Config &config)
     gpio_pull_up(m_config.scl_pin);
 
     m_display.external_vcc = false;
-    ssd1306_init(&m_display, 128, 64, m_config.i2c_address, m_config.i2c_block);
+    ssd1306_init_static(&m_display, WIDTH, HEIGHT, m_config.i2c_address, m_config.i2c_block, m_buffer.data(),
+                        m_dma_buffer.data());
     ssd1306_clear(&m_display);
 }
 
@@ -157,11 +160,12 @@ void Display::setUsbMode(usb_mode_t mode) { m_usb_mode = mode; };
 void Display::setPlayerId(uint8_t player_id) { m_player_id = player_id; };
 
 void Display::setMenuState(const Utils::Menu::State &menu_state) { m_menu_state = menu_state; }
+void Display::setLatency(const Utils::LatencyHistogram::Summary &latency) { m_latency = latency; }
 
 void Display::showIdle() { m_state = State::Idle; }
 void Display::showMenu() { m_state = State::Menu; }
 
-static std::string modeToString(usb_mode_t mode) {
+static const char *modeToString(usb_mode_t mode) {
     switch (mode) {
     case USB_MODE_SWITCH_DIVACON:
         return "Switch Diva";
@@ -210,29 +214,32 @@ static uint16_t calculateBpm(const Utils::InputState::Buttons &buttons) {
 
     struct StatBuffer {
       private:
-        std::list<uint16_t> m_buf;
-        size_t m_max_size;
+        std::array<uint16_t, window_size> m_buf;
+        size_t m_next;
+        size_t m_size;
 
       public:
-        StatBuffer(size_t max_size) : m_max_size(max_size) {}
+        StatBuffer() : m_buf({}), m_next(0), m_size(0) {}
 
-        void clear() { m_buf.clear(); };
+        void clear() {
+            m_next = 0;
+            m_size = 0;
+        };
 
         void insert(uint16_t val) {
-            if (m_buf.size() >= m_max_size) {
-                m_buf.pop_back();
-            }
-            m_buf.push_front(val);
+            m_buf[m_next] = val;
+            m_next = (m_next + 1) % m_buf.size();
+            m_size = std::min(m_size + 1, m_buf.size());
         };
 
         uint16_t avg() {
-            if (m_buf.size() > 0) {
-                return std::accumulate(m_buf.begin(), m_buf.end(), 0) / m_buf.size();
+            if (m_size > 0) {
+                return std::accumulate(m_buf.begin(), m_buf.begin() + m_size, 0) / m_size;
             }
             return 0;
         }
     };
-    static StatBuffer stat_buffer(window_size);
+    static StatBuffer stat_buffer;
 
     uint32_t now = to_ms_since_boot(get_absolute_time());
     uint32_t interval = now - prev_press;
@@ -261,14 +268,22 @@ static uint16_t calculateBpm(const Utils::InputState::Buttons &buttons) {
 }
 
 void Display::drawIdleScreen() {
+    char text[32];
+
     // Header
-    std::string mode_string = modeToString(m_usb_mode) + " mode";
-    ssd1306_draw_string(&m_display, 0, 0, 1, mode_string.c_str());
+    snprintf(text, sizeof(text), "%s mode", modeToString(m_usb_mode));
+    ssd1306_draw_string(&m_display, 0, 0, 1, text);
     ssd1306_draw_line(&m_display, 0, 10, 128, 10);
 
     // BPM
-    auto bpm_str = std::to_string(calculateBpm(m_buttons)) + " bpm";
-    ssd1306_draw_string(&m_display, (127 - (bpm_str.length() * 12)) / 2, 20, 2, bpm_str.c_str());
+    snprintf(text, sizeof(text), "%u bpm", calculateBpm(m_buttons));
+    ssd1306_draw_string(&m_display, (127 - (strlen(text) * 12)) / 2, 20, 2, text);
+
+    // Input latency, only available with latency probes enabled
+    if (m_latency.count) {
+        snprintf(text, sizeof(text), "p50 %" PRIu32 " p99 %" PRIu32 "us", m_latency.p50_us, m_latency.p99_us);
+        ssd1306_draw_string(&m_display, (127 - (strlen(text) * 6)) / 2, 37, 1, text);
+    }
 
     // Player "LEDs"
     if (m_player_id != 0) {
@@ -295,13 +310,13 @@ void Display::drawIdleScreen() {
 }
 
 void Display::drawMenuScreen() {
-    auto descriptor_it = Utils::Menu::descriptors.find(m_menu_state.page);
-    if (descriptor_it == Utils::Menu::descriptors.end()) {
+    const auto descriptor = Utils::Menu::findDescriptor(m_menu_state.page);
+    if (descriptor == nullptr) {
         return;
     }
 
     // Background
-    switch (descriptor_it->second.type) {
+    switch (descriptor->type) {
     case Utils::Menu::Descriptor::Type::Menu:
         if (m_menu_state.page == Utils::Menu::Page::Main) {
             ssd1306_bmp_show_image(&m_display, menu_screen_top.data(), menu_screen_top.size());
@@ -319,30 +334,32 @@ void Display::drawMenuScreen() {
     }
 
     // Heading
-    ssd1306_draw_string(&m_display, 0, 0, 1, descriptor_it->second.name.c_str());
+    ssd1306_draw_string(&m_display, 0, 0, 1, descriptor->name);
 
     // Current Selection
-    std::string selection;
-    switch (descriptor_it->second.type) {
+    char value[4];
+    const char *selection = "";
+    switch (descriptor->type) {
     case Utils::Menu::Descriptor::Type::Menu:
     case Utils::Menu::Descriptor::Type::Selection:
     case Utils::Menu::Descriptor::Type::RebootInfo:
-        selection = descriptor_it->second.items.at(m_menu_state.selected_value).first;
+        selection = descriptor->items[m_menu_state.selected_value].name;
         break;
     case Utils::Menu::Descriptor::Type::Value:
-        selection = std::to_string(m_menu_state.selected_value);
+        snprintf(value, sizeof(value), "%u", m_menu_state.selected_value);
+        selection = value;
         break;
     case Utils::Menu::Descriptor::Type::Toggle:
         selection = m_menu_state.selected_value ? "On" : "Off";
         break;
     }
-    ssd1306_draw_string(&m_display, (127 - (selection.length() * 12)) / 2, 15, 2, selection.c_str());
+    ssd1306_draw_string(&m_display, (127 - (strlen(selection) * 12)) / 2, 15, 2, selection);
 
     // Breadcrumbs
-    switch (descriptor_it->second.type) {
+    switch (descriptor->type) {
     case Utils::Menu::Descriptor::Type::Menu:
     case Utils::Menu::Descriptor::Type::Selection: {
-        auto selection_count = descriptor_it->second.items.size();
+        auto selection_count = descriptor->items.size();
         for (uint8_t i = 0; i < selection_count; ++i) {
             if (i == m_menu_state.selected_value) {
                 ssd1306_draw_square(&m_display, ((127) - ((selection_count - i) * 6)) - 1, 2, 4, 4);
@@ -360,13 +377,10 @@ void Display::drawMenuScreen() {
 }
 
 void Display::update() {
-    static const uint32_t interval_ms = 20; // Limit to ~50fps
-    static uint32_t start_ms = 0;
-
-    if (to_ms_since_boot(get_absolute_time()) - start_ms < interval_ms) {
+    // The previous frame is still being sent, drawing now would only end up waiting for it.
+    if (ssd1306_busy(&m_display)) {
         return;
     }
-    start_ms += interval_ms;
 
     ssd1306_clear(&m_display);
 
@@ -1,5 +1,7 @@
 #include "peripherals/TouchSlider.h"
 
+#include "utils/HotPath.h"
+
 #include "hardware/gpio.h"
 
 namespace Divacon::Peripherals {
@@ -21,13 +23,12 @@ TouchSlider::TouchControllerMpr121x3::TouchControllerMpr121x3(const TouchSlider:
                                                               i2c_inst *i2c) {
     size_t idx = 0;
     for (auto &mpr121 : m_mpr121) {
-        mpr121 = std::make_unique<Mpr121>(config.i2c_addresses[idx], i2c, config.touch_threshold,
-                                          config.release_threshold, true);
+        mpr121.emplace(config.i2c_addresses[idx], i2c, config.touch_threshold, config.release_threshold, true);
         idx++;
     }
 }
 
-uint32_t TouchSlider::TouchControllerMpr121x3::read() {
+uint32_t DIVACON_HOT_PATH TouchSlider::TouchControllerMpr121x3::read() {
     // Electrodes are mapped according to below table.
     //
     //         | m_mpr121[0] | m_mpr121[1] | m_mpr121[2] |
@@ -43,13 +44,12 @@ TouchSlider::TouchControllerMpr121x4::TouchControllerMpr121x4(const TouchSlider:
                                                               i2c_inst *i2c) {
     size_t idx = 0;
     for (auto &mpr121 : m_mpr121) {
-        mpr121 = std::make_unique<Mpr121>(config.i2c_addresses[idx], i2c, config.touch_threshold,
-                                          config.release_threshold, true);
+        mpr121.emplace(config.i2c_addresses[idx], i2c, config.touch_threshold, config.release_threshold, true);
         idx++;
     }
 }
 
-uint32_t TouchSlider::TouchControllerMpr121x4::read() {
+uint32_t DIVACON_HOT_PATH TouchSlider::TouchControllerMpr121x4::read() {
     // Electrodes are mapped according to below table.
     //
     //         | m_mpr121[0] | m_mpr121[1] | m_mpr121[2] | m_mpr121[3] |
@@ -66,13 +66,12 @@ uint32_t TouchSlider::TouchControllerMpr121x4::read() {
 TouchSlider::TouchControllerCap1188::TouchControllerCap1188(const TouchSlider::Config::Cap1188 &config, i2c_inst *i2c) {
     size_t idx = 0;
     for (auto &cap1188 : m_cap1188) {
-        cap1188 = std::make_unique<Cap1188>(config.i2c_addresses[idx], i2c, config.threshold, config.sensitivity,
-                                            Cap1188::Gain::G1);
+        cap1188.emplace(config.i2c_addresses[idx], i2c, config.threshold, config.sensitivity, Cap1188::Gain::G1);
         idx++;
     }
 }
 
-uint32_t TouchSlider::TouchControllerCap1188::read() {
+uint32_t DIVACON_HOT_PATH TouchSlider::TouchControllerCap1188::read() {
     // Electrodes are mapped according to below table.
     //
     //         | m_cap1188[0] | m_cap1188[1] | m_cap1188[2] | m_cap1188[3] |
@@ -88,13 +87,12 @@ TouchSlider::TouchControllerIs31se5117a::TouchControllerIs31se5117a(const TouchS
                                                                     i2c_inst *i2c) {
     size_t idx = 0;
     for (auto &is31se5117a : m_is31se5117a) {
-        is31se5117a =
-            std::make_unique<Is31se5117a>(config.i2c_addresses[idx], i2c, config.threshold, config.hysteresis);
+        is31se5117a.emplace(config.i2c_addresses[idx], i2c, config.threshold, config.hysteresis);
         idx++;
     }
 }
 
-uint32_t TouchSlider::TouchControllerIs31se5117a::read() {
+uint32_t DIVACON_HOT_PATH TouchSlider::TouchControllerIs31se5117a::read() {
     // Electrodes are mapped according to below table.
     //
     //         | m_is31se5117a[0] | m_is31se5117a[1] |
@@ -105,7 +103,8 @@ uint32_t TouchSlider::TouchControllerIs31se5117a::read() {
     return ((reverseBits(m_is31se5117a[0]->getTouched()) << 16) | reverseBits(m_is31se5117a[1]->getTouched()));
 }
 
-TouchSlider::TouchSlider(const Config &config, usb_mode_t mode) : m_config(config), m_mode(mode), m_touched(0) {
+TouchSlider::TouchSlider(const Config &config, usb_mode_t mode)
+    : m_config(config), m_mode(mode), m_touched(0), m_touch_controller(nullptr) {
     gpio_set_function(m_config.sda_pin, GPIO_FUNC_I2C);
     gpio_set_function(m_config.scl_pin, GPIO_FUNC_I2C);
     gpio_pull_up(m_config.sda_pin);
@@ -118,13 +117,17 @@ TouchSlider::TouchSlider(const Config &config, usb_mode_t mode) : m_config(confi
             using T = std::decay_t<decltype(config)>;
 
             if constexpr (std::is_same_v<T, Config::Mpr121x3>) {
-                m_touch_controller = std::make_unique<TouchControllerMpr121x3>(config, m_config.i2c_block);
+                m_touch_controller =
+                    &m_touch_controller_storage.emplace<TouchControllerMpr121x3>(config, m_config.i2c_block);
             } else if constexpr (std::is_same_v<T, Config::Mpr121x4>) {
-                m_touch_controller = std::make_unique<TouchControllerMpr121x4>(config, m_config.i2c_block);
+                m_touch_controller =
+                    &m_touch_controller_storage.emplace<TouchControllerMpr121x4>(config, m_config.i2c_block);
             } else if constexpr (std::is_same_v<T, Config::Cap1188>) {
-                m_touch_controller = std::make_unique<TouchControllerCap1188>(config, m_config.i2c_block);
+                m_touch_controller =
+                    &m_touch_controller_storage.emplace<TouchControllerCap1188>(config, m_config.i2c_block);
             } else if constexpr (std::is_same_v<T, Config::Is31se5117a>) {
-                m_touch_controller = std::make_unique<TouchControllerIs31se5117a>(config, m_config.i2c_block);
+                m_touch_controller =
+                    &m_touch_controller_storage.emplace<TouchControllerIs31se5117a>(config, m_config.i2c_block);
             } else {
                 static_assert(false, "Unknown touch controller!");
             }
@@ -132,7 +135,7 @@ TouchSlider::TouchSlider(const Config &config, usb_mode_t mode) : m_config(confi
         m_config.touch_config);
 }
 
-void TouchSlider::updateInputStateArcade(Utils::InputState &input_state) {
+void DIVACON_HOT_PATH TouchSlider::updateInputStateArcade(Utils::InputState &input_state) {
     // The 32bit state vector is mapped into the 4 8bit axes of the analog sticks, XORed
     // with the stick center postion to ensure no stick movement when the slider is not touched.
     input_state.sticks.right.y = (uint8_t)((m_touched & 0xFF000000) >> 24) ^ Utils::InputState::AnalogStick::center;
@@ -141,7 +144,7 @@ void TouchSlider::updateInputStateArcade(Utils::InputState &input_state) {
     input_state.sticks.left.x = (uint8_t)((m_touched & 0x000000FF)) ^ Utils::InputState::AnalogStick::center;
 }
 
-void TouchSlider::updateInputStateStick(Utils::InputState &input_state) {
+void DIVACON_HOT_PATH TouchSlider::updateInputStateStick(Utils::InputState &input_state) {
     struct State {
         uint8_t left_limit;
         uint8_t right_limit;
@@ -204,10 +207,15 @@ void TouchSlider::updateInputStateStick(Utils::InputState &input_state) {
     input_state.sticks.right.y = Utils::InputState::AnalogStick::center;
 }
 
-void TouchSlider::updateInputState(Utils::InputState &input_state) {
-
+void DIVACON_HOT_PATH TouchSlider::updateInputState(Utils::InputState &input_state) {
     read();
 
+    updateInputState(input_state, m_touched);
+}
+
+void DIVACON_HOT_PATH TouchSlider::updateInputState(Utils::InputState &input_state, uint32_t touched) {
+    m_touched = touched;
+
     switch (m_mode) {
 
     case USB_MODE_SWITCH_DIVACON:
@@ -230,13 +238,15 @@ void TouchSlider::updateInputState(Utils::InputState &input_state) {
     input_state.touches = m_touched;
 }
 
-void TouchSlider::read() {
+void DIVACON_HOT_PATH TouchSlider::read() {
     static uint32_t last_read = 0;
 
     uint32_t now = to_ms_since_boot(get_absolute_time());
     if ((last_read + 1) <= now) {
-        m_touched = m_touch_controller->read();
+        m_touched = scan();
     }
 }
 
+uint32_t DIVACON_HOT_PATH TouchSlider::scan() { return m_touch_controller->read(); }
+
 } // namespace Divacon::Peripherals
\ No newline at end of file
@@ -1,283 +1,349 @@
 #include "peripherals/TouchSliderLeds.h"
 
+#include "utils/HotPath.h"
+
 #include "pico/rand.h"
+#include "pico/time.h"
 #include "pio_ws2812/ws2812.h"
 
 #include <algorithm>
+#include <cstdlib>
 
 namespace Divacon::Peripherals {
 
 namespace {
+
+using Effect = Utils::LedAnimator::Effect;
+using Source = Utils::LedAnimator::Source;
+
 const static uint32_t pulse_step_count = 4096;
-static const uint8_t pulse_dim_percent_min = 40;
-static const uint8_t pulse_dim_percent_max = 100;
+const static Utils::LedAnimator::Keyframe pulse_keyframes[] = {{0, 100}, {60, 40}, {120, 100}};
 
 const static uint32_t rainbow_step_count = 4096;
 
 const static uint32_t fade_step_count = 2048;
 
-const static uint32_t blend_step_count = 128;
-
-// Use alternating frames to allow for smoother animation
+// Two interleaved phases to allow for smoother animation
 const static size_t rainbow_length = 40;
-const static std::array<std::array<TouchSliderLeds::Config::Color, rainbow_length>, 2> rainbow_colors{{
-    {{
-        {0x5a, 0x3a, 0xc6}, {0x76, 0x36, 0xaa}, {0x91, 0x34, 0x8e}, {0xad, 0x30, 0x72}, {0xca, 0x2e, 0x56},
-        {0xe6, 0x2a, 0x3a}, {0xf2, 0x2f, 0x2b}, {0xe6, 0x42, 0x33}, {0xce, 0x5c, 0x46}, {0xb6, 0x74, 0x59},
-        {0x9e, 0x8d, 0x6c}, {0x86, 0xa6, 0x7e}, {0x6e, 0xbf, 0x90}, {0x57, 0xd8, 0xa3}, {0x4c, 0xea, 0xac},
-        {0x58, 0xf0, 0xa3}, {0x6d, 0xf0, 0x92}, {0x83, 0xf0, 0x82}, {0x99, 0xf0, 0x72}, {0xae, 0xf0, 0x61},
-        {0xc4, 0xf0, 0x50}, {0xdb, 0xf0, 0x40}, {0xec, 0xea, 0x34}, {0xf2, 0xdc, 0x34}, {0xf4, 0xc9, 0x38},
-        {0xf6, 0xb6, 0x3c}, {0xf8, 0xa2, 0x40}, {0xfa, 0x90, 0x45}, {0xfc, 0x7d, 0x49}, {0xfe, 0x6a, 0x4d},
-        {0xf8, 0x5c, 0x56}, {0xe2, 0x56, 0x68}, {0xc6, 0x52, 0x7d}, {0xaa, 0x50, 0x93}, {0x8e, 0x4c, 0xa9},
-        {0x72, 0x4a, 0xbf}, {0x56, 0x46, 0xd5}, {0x3a, 0x44, 0xeb}, {0x2e, 0x40, 0xf3}, {0x3e, 0x3c, 0xe2},
-    }},
-    {{
-        {0x68, 0x38, 0xb7}, {0x83, 0x35, 0x9c}, {0x9f, 0x32, 0x80}, {0xbb, 0x2f, 0x64}, {0xd8, 0x2c, 0x48},
-        {0xf3, 0x29, 0x2c}, {0xf2, 0x35, 0x2a}, {0xda, 0x4f, 0x3c}, {0xc3, 0x68, 0x50}, {0xaa, 0x81, 0x62},
-        {0x92, 0x99, 0x75}, {0x7a, 0xb2, 0x87}, {0x63, 0xcc, 0x9a}, {0x4b, 0xe5, 0xac}, {0x4d, 0xf0, 0xab},
-        {0x62, 0xf0, 0x9b}, {0x78, 0xf0, 0x8a}, {0x8e, 0xf0, 0x7a}, {0xa4, 0xf0, 0x69}, {0xb9, 0xf0, 0x59},
-        {0xd0, 0xf0, 0x48}, {0xe6, 0xf0, 0x37}, {0xf1, 0xe5, 0x32}, {0xf3, 0xd2, 0x36}, {0xf5, 0xc0, 0x3a},
-        {0xf7, 0xac, 0x3e}, {0xf9, 0x99, 0x43}, {0xfb, 0x86, 0x47}, {0xfd, 0x74, 0x4b}, {0xff, 0x61, 0x4f},
-        {0xf0, 0x57, 0x5d}, {0xd4, 0x54, 0x72}, {0xb7, 0x51, 0x88}, {0x9c, 0x4e, 0x9e}, {0x80, 0x4b, 0xb4},
-        {0x64, 0x48, 0xca}, {0x48, 0x45, 0xe0}, {0x2c, 0x42, 0xf6}, {0x2f, 0x3e, 0xf0}, {0x4c, 0x3b, 0xd4},
-    }},
+const static std::array<TouchSliderLeds::Config::Color, rainbow_length * 2> rainbow_colors{{
+    {0x5a, 0x3a, 0xc6}, {0x76, 0x36, 0xaa}, {0x91, 0x34, 0x8e}, {0xad, 0x30, 0x72}, {0xca, 0x2e, 0x56},
+    {0xe6, 0x2a, 0x3a}, {0xf2, 0x2f, 0x2b}, {0xe6, 0x42, 0x33}, {0xce, 0x5c, 0x46}, {0xb6, 0x74, 0x59},
+    {0x9e, 0x8d, 0x6c}, {0x86, 0xa6, 0x7e}, {0x6e, 0xbf, 0x90}, {0x57, 0xd8, 0xa3}, {0x4c, 0xea, 0xac},
+    {0x58, 0xf0, 0xa3}, {0x6d, 0xf0, 0x92}, {0x83, 0xf0, 0x82}, {0x99, 0xf0, 0x72}, {0xae, 0xf0, 0x61},
+    {0xc4, 0xf0, 0x50}, {0xdb, 0xf0, 0x40}, {0xec, 0xea, 0x34}, {0xf2, 0xdc, 0x34}, {0xf4, 0xc9, 0x38},
+    {0xf6, 0xb6, 0x3c}, {0xf8, 0xa2, 0x40}, {0xfa, 0x90, 0x45}, {0xfc, 0x7d, 0x49}, {0xfe, 0x6a, 0x4d},
+    {0xf8, 0x5c, 0x56}, {0xe2, 0x56, 0x68}, {0xc6, 0x52, 0x7d}, {0xaa, 0x50, 0x93}, {0x8e, 0x4c, 0xa9},
+    {0x72, 0x4a, 0xbf}, {0x56, 0x46, 0xd5}, {0x3a, 0x44, 0xeb}, {0x2e, 0x40, 0xf3}, {0x3e, 0x3c, 0xe2},
+    {0x68, 0x38, 0xb7}, {0x83, 0x35, 0x9c}, {0x9f, 0x32, 0x80}, {0xbb, 0x2f, 0x64}, {0xd8, 0x2c, 0x48},
+    {0xf3, 0x29, 0x2c}, {0xf2, 0x35, 0x2a}, {0xda, 0x4f, 0x3c}, {0xc3, 0x68, 0x50}, {0xaa, 0x81, 0x62},
+    {0x92, 0x99, 0x75}, {0x7a, 0xb2, 0x87}, {0x63, 0xcc, 0x9a}, {0x4b, 0xe5, 0xac}, {0x4d, 0xf0, 0xab},
+    {0x62, 0xf0, 0x9b}, {0x78, 0xf0, 0x8a}, {0x8e, 0xf0, 0x7a}, {0xa4, 0xf0, 0x69}, {0xb9, 0xf0, 0x59},
+    {0xd0, 0xf0, 0x48}, {0xe6, 0xf0, 0x37}, {0xf1, 0xe5, 0x32}, {0xf3, 0xd2, 0x36}, {0xf5, 0xc0, 0x3a},
+    {0xf7, 0xac, 0x3e}, {0xf9, 0x99, 0x43}, {0xfb, 0x86, 0x47}, {0xfd, 0x74, 0x4b}, {0xff, 0x61, 0x4f},
+    {0xf0, 0x57, 0x5d}, {0xd4, 0x54, 0x72}, {0xb7, 0x51, 0x88}, {0x9c, 0x4e, 0x9e}, {0x80, 0x4b, 0xb4},
+    {0x64, 0x48, 0xca}, {0x48, 0x45, 0xe0}, {0x2c, 0x42, 0xf6}, {0x2f, 0x3e, 0xf0}, {0x4c, 0x3b, 0xd4},
+}};
+const static Utils::LedAnimator::Palette rainbow_palette = {rainbow_colors.data(), rainbow_length, 2};
+
+// Indexed by Config::IdleMode and Config::TouchedMode.
+const static std::array<Effect, 5> idle_effects = {{
+    {Source::Off, nullptr, 0, 0, nullptr, 0, false, 0},
+    {Source::Color, nullptr, 0, 0, nullptr, 0, false, 0},
+    {Source::Color, pulse_keyframes, std::size(pulse_keyframes), pulse_step_count, nullptr, 0, false, 0},
+    {Source::Palette, nullptr, 0, 0, &rainbow_palette, 0, false, 0},
+    {Source::Palette, nullptr, 0, 0, &rainbow_palette, rainbow_step_count, false, 0},
+}};
+const static std::array<Effect, 5> touched_effects = {{
+    {Source::Off, nullptr, 0, 0, nullptr, 0, false, 0},
+    {Source::Idle, nullptr, 0, 0, nullptr, 0, false, 0},
+    {Source::Color, nullptr, 0, 0, nullptr, 0, true, 0},
+    {Source::Color, nullptr, 0, 0, nullptr, 0, true, fade_step_count},
+    {Source::Idle, nullptr, 0, 0, nullptr, 0, true, fade_step_count},
 }};
 
-struct AnimationStepper {
-    const uint32_t steps_to_advance;
-    uint32_t current_steps;
+} // namespace
 
-    uint32_t advance(uint32_t steps) {
-        current_steps += steps;
-        if (current_steps < steps_to_advance) {
-            return 0;
+TouchSliderLeds::TouchSliderLeds(const Config &config)
+    : m_config(config), m_frames({}), m_rendered_frame(nullptr), m_led_count(0),
+      m_segment_led_count({}), m_frame_pending(false),
+      m_output_lut({}), m_raw_output_lut({}),
+      m_animator(idle_effects[static_cast<size_t>(config.idle_mode)],
+                 touched_effects[static_cast<size_t>(config.touched_mode)], get_rand_32()),
+      m_shown_frame({}), m_output_lut_changed(true), m_since_shown_us(0), m_frame_stats({}),
+      m_player_color(std::nullopt), m_raw_mode(false), m_raw_received_us(0),
+      m_raw_latency_pending(false), m_raw_latency(100),
+      m_frame_interval_us(1000000 / std::max<uint16_t>(config.target_fps, 1)), m_pacing_started(false),
+      m_next_frame_us(0), m_last_frame_us(0), m_last_update_us(0), m_step_remainder(0), m_touched(0),
+      m_touched_changed(false), m_frame_time(250), m_frame_jitter(25) {
+    m_config.strip_count = std::min(m_config.strip_count, MAX_STRIPS);
+
+    std::array<uint8_t, MAX_STRIPS> pins = {};
+    std::array<size_t, MAX_STRIPS> lengths = {};
+    for (size_t idx = 0; idx < m_config.strip_count; ++idx) {
+        auto &strip = m_config.strips[idx];
+
+        strip.first_segment = std::min<size_t>(strip.first_segment, SEGMENT_COUNT);
+        strip.segment_count = std::min({static_cast<size_t>(strip.segment_count), SEGMENT_COUNT - strip.first_segment,
+                                        (m_frames[0].size() - m_led_count) / m_config.leds_per_segment});
+
+        pins[idx] = strip.pin;
+        lengths[idx] = strip.segment_count * m_config.leds_per_segment;
+        m_led_count += lengths[idx];
+
+        for (size_t segment = strip.first_segment; segment < strip.first_segment + strip.segment_count; ++segment) {
+            m_segment_led_count[segment] += m_config.leds_per_segment;
         }
+    }
 
-        const auto advance = current_steps / steps_to_advance;
+    updateOutputLuts();
 
-        current_steps %= steps_to_advance;
+    updateIdleColor();
+    m_animator.setTouchedColor(m_config.touched_color);
 
-        return advance;
+    for (auto &frame : m_frames) {
+        std::fill_n(frame.begin(), m_led_count, ws2812_rgb_to_u32pixel(0, 0, 0));
     }
-};
 
-TouchSliderLeds::Config::Color dim_color(const TouchSliderLeds::Config::Color &color, float dim_factor) {
-    return TouchSliderLeds::Config::Color{
-        .r = (uint8_t)((float)color.r * dim_factor),
-        .g = (uint8_t)((float)color.g * dim_factor),
-        .b = (uint8_t)((float)color.b * dim_factor),
-    };
+    static_assert(MAX_STRIPS <= WS2812_MAX_STRIPS);
+    ws2812_init_dma(pins.data(), lengths.data(), m_config.strip_count, m_config.is_rgbw, m_frames[0].data(),
+                    m_frames[1].data());
+    m_rendered_frame = ws2812_get_back_buffer();
 }
 
-TouchSliderLeds::Config::Color max_color(const TouchSliderLeds::Config::Color &a,
-                                         const TouchSliderLeds::Config::Color &b) {
-    return TouchSliderLeds::Config::Color{
-        .r = std::max(a.r, b.r),
-        .g = std::max(a.g, b.g),
-        .b = std::max(a.b, b.b),
-    };
+void TouchSliderLeds::setBrightness(uint8_t brightness) {
+    m_config.brightness = brightness;
+    updateOutputLuts();
 }
+void TouchSliderLeds::setAnimationSpeed(uint8_t speed) { m_config.animation_speed = speed; };
+void TouchSliderLeds::setIdleMode(Config::IdleMode mode) {
+    m_config.idle_mode = mode;
+    m_animator.setIdleEffect(idle_effects[static_cast<size_t>(mode)]);
+};
+void TouchSliderLeds::setTouchedMode(Config::TouchedMode mode) {
+    m_config.touched_mode = mode;
+    m_animator.setTouchedEffect(touched_effects[static_cast<size_t>(mode)]);
+};
+void TouchSliderLeds::setIdleColor(Config::Color color) {
+    m_config.idle_color = color;
+    updateIdleColor();
+};
+void TouchSliderLeds::setTouchedColor(Config::Color color) {
+    m_config.touched_color = color;
+    m_animator.setTouchedColor(color);
+};
+void TouchSliderLeds::setEnablePlayerColor(bool do_enable) {
+    m_config.enable_player_color = do_enable;
+    updateIdleColor();
+};
+void TouchSliderLeds::setEnablePdloaderSupport(bool do_enable) { m_config.enable_pdloader_support = do_enable; };
 
-} // namespace
-
-TouchSliderLeds::TouchSliderLeds(const Config &config)
-    : m_config(config), m_touched(0), m_idle_buffer({}), m_touched_buffer({}), m_player_color(std::nullopt),
-      m_raw_mode(false) {
-    m_rendered_frame = std::vector<uint32_t>(32 * config.leds_per_segment, ws2812_rgb_to_u32pixel(0, 0, 0));
+void TouchSliderLeds::setTouched(uint32_t touched) {
+    m_touched_changed |= touched != m_touched;
+    m_touched = touched;
+    m_animator.setTouched(touched);
+}
+void TouchSliderLeds::setPlayerColor(TouchSliderLeds::Config::Color color) {
+    m_player_color = color;
+    updateIdleColor();
+}
 
-    ws2812_init(config.led_pin, m_config.is_rgbw);
+void TouchSliderLeds::updateIdleColor() {
+    m_animator.setIdleColor(m_config.enable_player_color ? m_player_color.value_or(m_config.idle_color)
+                                                         : m_config.idle_color);
 }
 
-void TouchSliderLeds::setBrightness(uint8_t brightness) { m_config.brightness = brightness; }
-void TouchSliderLeds::setAnimationSpeed(uint8_t speed) { m_config.animation_speed = speed; };
-void TouchSliderLeds::setIdleMode(Config::IdleMode mode) { m_config.idle_mode = mode; };
-void TouchSliderLeds::setTouchedMode(Config::TouchedMode mode) { m_config.touched_mode = mode; };
-void TouchSliderLeds::setIdleColor(Config::Color color) { m_config.idle_color = color; };
-void TouchSliderLeds::setTouchedColor(Config::Color color) { m_config.touched_color = color; };
-void TouchSliderLeds::setEnablePlayerColor(bool do_enable) { m_config.enable_player_color = do_enable; };
-void TouchSliderLeds::setEnablePdloaderSupport(bool do_enable) { m_config.enable_pdloader_support = do_enable; };
+void TouchSliderLeds::updateOutputLuts() {
+    const uint32_t brightness_scale = Utils::LedAnimator::toScale(m_config.brightness, 255);
+    const std::array<uint32_t, 3> calibration_scales = {
+        Utils::LedAnimator::toScale(m_config.calibration.r, 255),
+        Utils::LedAnimator::toScale(m_config.calibration.g, 255),
+        Utils::LedAnimator::toScale(m_config.calibration.b, 255),
+    };
+
+    const auto output = [&](uint8_t value, size_t channel) {
+        if (m_config.gamma_correction) {
+            value = ws2812_gamma_correct(value);
+        }
+        return Utils::LedAnimator::scale(value, calibration_scales[channel]);
+    };
 
-void TouchSliderLeds::setTouched(uint32_t touched) { m_touched = touched; }
-void TouchSliderLeds::setPlayerColor(TouchSliderLeds::Config::Color color) { m_player_color = color; }
+    for (size_t channel = 0; channel < calibration_scales.size(); ++channel) {
+        for (size_t value = 0; value < 256; ++value) {
+            m_output_lut[channel][value] = output(Utils::LedAnimator::scale(value, brightness_scale), channel);
+            m_raw_output_lut[channel][value] = output(value, channel);
+        }
+    }
 
-void TouchSliderLeds::updateIdle(uint32_t steps) {
-    // Pulse
-    static AnimationStepper pulse_stepper{pulse_step_count, 0};
-    static uint8_t pulse_dim_percent = pulse_dim_percent_max;
-    static int8_t pulse_advance_factor = -1;
+    m_output_lut_changed = true;
+}
 
-    // Rainbow
-    static AnimationStepper rainbow_stepper{rainbow_step_count, 0};
-    static size_t rainbow_position = get_rand_32() % rainbow_length;
+uint32_t DIVACON_HOT_PATH TouchSliderLeds::toPixel(const Config::Color &color, const OutputLut &lut) const {
+    return ws2812_rgb_to_u32pixel(lut[0][color.r], lut[1][color.g], lut[2][color.b]);
+}
 
-    if (steps <= 0) {
+void DIVACON_HOT_PATH TouchSliderLeds::limitCurrent(std::array<uint32_t, SEGMENT_COUNT> &pixels) {
+    if (m_config.max_current_ma == 0) {
         return;
     }
 
-    // Check for player color
-    const auto idle_color =
-        m_config.enable_player_color ? m_player_color.value_or(m_config.idle_color) : m_config.idle_color;
-
-    switch (m_config.idle_mode) {
-    case Config::IdleMode::Off:
-        m_idle_buffer.fill({0x00, 0x00, 0x00});
-        break;
-    case Config::IdleMode::Static:
-        m_idle_buffer.fill(idle_color);
-        break;
-    case Config::IdleMode::Pulse: {
-        const auto advance = pulse_stepper.advance(steps);
-
-        if (pulse_advance_factor < 0 && advance >= (uint8_t)(pulse_dim_percent - pulse_dim_percent_min)) {
-            pulse_dim_percent = pulse_dim_percent_min;
-            pulse_advance_factor = -pulse_advance_factor;
-        } else if (pulse_advance_factor > 0 && advance + pulse_dim_percent >= pulse_dim_percent_max) {
-            pulse_dim_percent = pulse_dim_percent_max;
-            pulse_advance_factor = -pulse_advance_factor;
-        } else {
-            pulse_dim_percent = pulse_dim_percent + (pulse_advance_factor * advance);
-        }
+    // Sum of all channel values of all LEDs, every 255 draw `channel_current_ma`.
+    uint32_t total = 0;
+    for (size_t segment = 0; segment < SEGMENT_COUNT; ++segment) {
+        const uint32_t pixel = pixels[segment];
+        total += ((pixel >> 24) + ((pixel >> 16) & 0xff) + ((pixel >> 8) & 0xff)) * m_segment_led_count[segment];
+    }
 
-        m_idle_buffer.fill(dim_color(idle_color, (float)pulse_dim_percent / 100.));
-    } break;
-    case Config::IdleMode::RainbowCycle:
-        rainbow_position =
-            (rainbow_position + rainbow_stepper.advance(steps)) % (rainbow_length * rainbow_colors.size());
-        [[fallthrough]];
-    case Config::IdleMode::RainbowStatic: {
-        const auto frame = rainbow_position % rainbow_colors.size();
-        const auto frame_position = rainbow_position / rainbow_colors.size();
-
-        for (size_t idx = 0; idx < m_idle_buffer.size(); ++idx) {
-            size_t offset = (frame_position + idx) % rainbow_length;
-            m_idle_buffer[idx] = rainbow_colors[frame][offset];
-        }
-    } break;
+    const uint64_t current = static_cast<uint64_t>(total) * m_config.channel_current_ma;
+    const uint64_t budget = static_cast<uint64_t>(m_config.max_current_ma) * 255;
+    if (current <= budget) {
+        return;
     }
-}
-void TouchSliderLeds::updateTouched(uint32_t steps) {
-    static AnimationStepper fade_stepper{fade_step_count, 0};
-    static std::array<uint8_t, SEGMENT_COUNT> fade_percent = {};
-
-    switch (m_config.touched_mode) {
-    case Config::TouchedMode::Off:
-        m_touched_buffer.fill({0x00, 0x00, 0x00});
-        break;
-    case Config::TouchedMode::Idle:
-        std::copy(m_idle_buffer.cbegin(), m_idle_buffer.cend(), m_touched_buffer.begin());
-        break;
-    case Config::TouchedMode::Touched:
-        for (size_t idx = 0; idx < SEGMENT_COUNT; ++idx) {
-            if (m_touched & ((uint32_t)0x80000000 >> idx)) {
-                m_touched_buffer[idx] = m_config.touched_color;
-            } else {
-                m_touched_buffer[idx] = {0x00, 0x00, 0x00};
-            }
-        }
-        break;
-    case Config::TouchedMode::TouchedFade: {
-        const auto advance = fade_stepper.advance(steps);
-
-        for (size_t idx = 0; idx < SEGMENT_COUNT; ++idx) {
-            if (m_touched & ((uint32_t)0x80000000 >> idx)) {
-                m_touched_buffer[idx] = m_config.touched_color;
-                fade_percent[idx] = 100;
-            } else {
-                m_touched_buffer[idx] = dim_color(m_touched_buffer[idx], (float)fade_percent[idx] / 100.);
-                fade_percent[idx] = advance > fade_percent[idx] ? 0 : fade_percent[idx] - advance;
-            }
-        }
-    } break;
-    case Config::TouchedMode::TouchedIdle: {
-        const auto advance = fade_stepper.advance(steps);
-
-        for (size_t idx = 0; idx < SEGMENT_COUNT; ++idx) {
-            if (m_touched & ((uint32_t)0x80000000 >> idx)) {
-                m_touched_buffer[idx] = m_idle_buffer[idx];
-                fade_percent[idx] = 100;
-            } else {
-                m_touched_buffer[idx] = dim_color(m_touched_buffer[idx], (float)fade_percent[idx] / 100.);
-                fade_percent[idx] = advance > fade_percent[idx] ? 0 : fade_percent[idx] - advance;
-            }
-        }
-    } break;
+
+    // Rounded down to stay within the budget.
+    const uint32_t scale = (budget * 65536) / current;
+    for (auto &pixel : pixels) {
+        pixel = static_cast<uint32_t>(Utils::LedAnimator::scale(pixel >> 24, scale)) << 24 |
+                static_cast<uint32_t>(Utils::LedAnimator::scale((pixel >> 16) & 0xff, scale)) << 16 |
+                static_cast<uint32_t>(Utils::LedAnimator::scale((pixel >> 8) & 0xff, scale)) << 8;
     }
-}
 
-void TouchSliderLeds::render(uint32_t steps) {
-    static AnimationStepper blend_stepper{blend_step_count, 0};
-    static uint8_t blend_percent = 100;
+    m_frame_stats.limited++;
+}
 
-    const auto blend_advance = blend_stepper.advance(steps);
-    if (m_touched) {
-        blend_percent = blend_advance > blend_percent ? 0 : blend_percent - blend_advance;
-    } else {
-        blend_percent = blend_advance + blend_percent > 100 ? 100 : blend_percent + blend_advance;
-    }
+void DIVACON_HOT_PATH TouchSliderLeds::render(const std::array<uint32_t, SEGMENT_COUNT> &pixels) {
+    uint32_t *led = m_rendered_frame;
+    for (size_t strip_idx = 0; strip_idx < m_config.strip_count; ++strip_idx) {
+        const auto &strip = m_config.strips[strip_idx];
 
-    const float brightness_dim_factor = (float)m_config.brightness / 255.;
-    const float blend_dim_factor = (float)blend_percent / 100.;
+        for (size_t idx = 0; idx < strip.segment_count; ++idx) {
+            const size_t segment = strip.first_segment + (strip.reverse ? strip.segment_count - 1 - idx : idx);
 
-    size_t idx = 0;
-    for (auto &rendered_segment : m_rendered_frame) {
-        auto blended_segment = max_color(dim_color(m_idle_buffer[idx / m_config.leds_per_segment], blend_dim_factor),
-                                         m_touched_buffer[idx / m_config.leds_per_segment]);
+            led = std::fill_n(led, m_config.leds_per_segment, pixels[segment]);
+        }
+    }
+}
 
-        rendered_segment =
-            ws2812_rgb_to_u32pixel(blended_segment.r * brightness_dim_factor, blended_segment.g * brightness_dim_factor,
-                                   blended_segment.b * brightness_dim_factor);
+void DIVACON_HOT_PATH TouchSliderLeds::show() {
+    // Retried on the next update if the previous frame is still being sent.
+    m_frame_pending = !ws2812_swap_buffers();
+    if (!m_frame_pending) {
+        m_rendered_frame = ws2812_get_back_buffer();
+        m_frame_stats.pushed++;
 
-        ++idx;
+        if (m_raw_latency_pending) {
+            m_raw_latency.add(time_us_32() - m_raw_received_us);
+            m_raw_latency_pending = false;
+        }
     }
 }
 
-void TouchSliderLeds::show() { ws2812_put_frame(m_rendered_frame.data(), m_rendered_frame.size()); }
+void DIVACON_HOT_PATH TouchSliderLeds::update(uint32_t now_us) {
+    // The frame grid starts with the first update, so it lines up with the task calling it.
+    if (!m_pacing_started) {
+        m_next_frame_us = now_us;
+        m_last_frame_us = now_us;
+        m_last_update_us = now_us;
+        m_pacing_started = true;
+    }
 
-void TouchSliderLeds::update() {
-    static uint32_t previous_frame_time = to_ms_since_boot(get_absolute_time());
+    const uint32_t elapsed_us = now_us - m_last_update_us;
+    m_last_update_us = now_us;
+
+    // Frames are due on a fixed grid and an update renders the frame of the nearest slot, so it may run a little
+    // early. Slots passed while running late are dropped and the animations skip ahead by their timesteps to stay in
+    // step with real time.
+    const int32_t half_interval_us = m_frame_interval_us / 2;
+    const int32_t offset_us = static_cast<int32_t>(now_us - m_next_frame_us);
+    uint32_t frames = 0;
+    if (offset_us >= -half_interval_us) {
+        frames = (offset_us + half_interval_us) / m_frame_interval_us + 1;
+        m_frame_jitter.add(std::abs(offset_us - static_cast<int32_t>((frames - 1) * m_frame_interval_us)));
+        m_frame_time.add(now_us - m_last_frame_us);
+
+        m_next_frame_us += frames * m_frame_interval_us;
+        m_last_frame_us = now_us;
+        m_frame_stats.dropped += frames - 1;
+    } else if (!m_touched_changed && !m_frame_pending) {
+        // Released early by a trigger with nothing new to show.
+        return;
+    }
+    m_touched_changed = false;
 
-    const uint32_t now = to_ms_since_boot(get_absolute_time());
-    const uint32_t elapsed = now - previous_frame_time;
-    const uint32_t steps = elapsed * m_config.animation_speed;
+    // `animation_speed` steps per millisecond, the rest is carried over to the next frame.
+    const uint32_t step_us =
+        m_step_remainder + std::min(frames, MAX_CATCH_UP_FRAMES) * m_frame_interval_us * m_config.animation_speed;
+    const uint32_t steps = step_us / 1000;
 
-    previous_frame_time = now;
+    m_step_remainder = step_us % 1000;
 
     if (m_raw_mode && m_config.enable_pdloader_support) {
+        if (m_frame_pending) {
+            show();
+        }
         return;
     }
 
-    updateIdle(steps);
-    updateTouched(steps);
+    const auto &frame = m_animator.update(steps);
+
+    // Periodic refreshes recover from glitched frames even when nothing changes.
+    m_since_shown_us += elapsed_us;
+    if (!m_frame_pending && !m_output_lut_changed && m_since_shown_us < REFRESH_INTERVAL_US &&
+        frame == m_shown_frame) {
+        m_frame_stats.skipped++;
+        return;
+    }
+
+    std::array<uint32_t, SEGMENT_COUNT> pixels;
+    for (size_t segment = 0; segment < SEGMENT_COUNT; ++segment) {
+        pixels[segment] = toPixel(frame[segment], m_output_lut);
+    }
 
-    render(steps);
+    limitCurrent(pixels);
+    render(pixels);
     show();
+
+    if (m_frame_pending) {
+        m_frame_stats.reused += frames > 0;
+    } else {
+        m_shown_frame = frame;
+        m_output_lut_changed = false;
+        m_since_shown_us = 0;
+    }
 }
 
-void TouchSliderLeds::update(const TouchSliderLeds::RawFrameMessage &frame) {
+void DIVACON_HOT_PATH TouchSliderLeds::update(const TouchSliderLeds::RawFrameMessage &frame) {
     if (!m_config.enable_pdloader_support) {
         return;
     }
 
     m_raw_mode = true;
-
-    size_t idx = 0;
-    for (const auto &color : frame) {
-        for (int led = 0; led < m_config.leds_per_segment; ++led) {
-            // Allow limiting max brightness to stay within USB power restrictions.
-            uint8_t color_max = std::max(color.r, std::max(color.g, color.b));
-            if (color_max > m_config.brightness) {
-                float dim_factor = (float)m_config.brightness / (float)color_max;
-                m_rendered_frame.at((idx * m_config.leds_per_segment) + led) = ws2812_rgb_to_u32pixel(
-                    (float)color.r * dim_factor, (float)color.g * dim_factor, (float)color.b * dim_factor);
-            } else {
-                m_rendered_frame.at((idx * m_config.leds_per_segment) + led) =
-                    ws2812_rgb_to_u32pixel(color.r, color.g, color.b);
-            }
-        }
-        ++idx;
+    m_raw_received_us = frame.received_us;
+    m_raw_latency_pending = true;
+
+    std::array<uint32_t, SEGMENT_COUNT> pixels;
+    for (size_t segment = 0; segment < SEGMENT_COUNT; ++segment) {
+        const uint8_t *grb = &frame.grb[(SEGMENT_COUNT - 1 - segment) * 3];
+        const Config::Color color = {grb[1], grb[0], grb[2]};
+
+        // Allow limiting max brightness to stay within USB power restrictions.
+        const uint8_t color_max = std::max(color.r, std::max(color.g, color.b));
+        const auto limited_color =
+            color_max > m_config.brightness
+                ? Utils::LedAnimator::dim(color, Utils::LedAnimator::toScale(m_config.brightness, color_max))
+                : color;
+        pixels[segment] = toPixel(limited_color, m_raw_output_lut);
     }
 
-    ws2812_put_frame(m_rendered_frame.data(), m_rendered_frame.size());
+    limitCurrent(pixels);
+    render(pixels);
+    show();
+}
+
+void TouchSliderLeds::resetFrameStats() {
+    m_frame_stats = {};
+    m_raw_latency.reset();
+    m_frame_time.reset();
+    m_frame_jitter.reset();
 }
 
 } // namespace Divacon::Peripherals
\ No newline at end of file
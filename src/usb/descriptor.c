@@ -0,0 +1,44 @@
+#include "usb/descriptor.h"
+
+#include <string.h>
+
+#define DESC_TYPE_CONFIGURATION (0x02)
+#define DESC_TYPE_ENDPOINT (0x05)
+#define DESC_CONFIGURATION_LEN (9)
+#define DESC_ENDPOINT_LEN (7)
+
+#define EP_DIR_IN (0x80)
+#define EP_XFER_TYPE_MASK (0x03)
+#define EP_XFER_INTERRUPT (0x03)
+
+uint16_t usbd_desc_cfg_set_interval(uint8_t *dst, uint16_t dst_size, const uint8_t *src, uint8_t interval) {
+    if (src[0] < DESC_CONFIGURATION_LEN || src[1] != DESC_TYPE_CONFIGURATION) {
+        return 0;
+    }
+
+    const uint16_t total_len = src[2] | (src[3] << 8);
+    if (total_len < DESC_CONFIGURATION_LEN || total_len > dst_size) {
+        return 0;
+    }
+
+    memcpy(dst, src, total_len);
+
+    uint16_t offset = 0;
+    while (offset < total_len) {
+        uint8_t *desc = &dst[offset];
+        const uint8_t len = desc[0];
+
+        if (len < 2 || len > total_len - offset) {
+            return 0;
+        }
+
+        if (desc[1] == DESC_TYPE_ENDPOINT && len >= DESC_ENDPOINT_LEN && (desc[2] & EP_DIR_IN) &&
+            (desc[3] & EP_XFER_TYPE_MASK) == EP_XFER_INTERRUPT) {
+            desc[6] = interval;
+        }
+
+        offset += len;
+    }
+
+    return total_len;
+}
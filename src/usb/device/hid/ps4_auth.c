@@ -74,6 +74,7 @@ void ps4_auth_init(const char *private_key, size_t private_key_len, const uint8_
     mbedtls_pk_init(&pk_context);
 
     if (mbedtls_pk_parse_key(&pk_context, (unsigned char *)private_key, private_key_len, NULL, 0)) {
+        mbedtls_pk_free(&pk_context);
         auth_state.initialized = false;
         return;
     }
@@ -84,6 +85,7 @@ void ps4_auth_init(const char *private_key, size_t private_key_len, const uint8_
                                NULL, 0,                                                                          //
                                NULL, 0,                                                                          //
                                auth_state.challenge_response.key_e, sizeof(auth_state.challenge_response.key_e))) {
+        mbedtls_pk_free(&pk_context);
         auth_state.initialized = false;
         return;
     }
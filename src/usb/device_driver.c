@@ -1,5 +1,6 @@
 #include "usb/device_driver.h"
 
+#include "usb/descriptor.h"
 #include "usb/device/hid/keyboard_driver.h"
 #include "usb/device/hid/ps3_driver.h"
 #include "usb/device/hid/ps4_driver.h"
@@ -8,20 +9,69 @@
 #include "usb/device/vendor/debug_driver.h"
 #include "usb/device/vendor/pdloader_driver.h"
 #include "usb/device/vendor/xinput_driver.h"
+#include "utils/HotPath.h"
 
 #include "bsp/board.h"
+#include "device/dcd.h"
+#include "hardware/structs/usb.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
 #include "pico/unique_id.h"
 #include "tusb.h"
 
 #include <string.h>
 
 #define DESC_STR_MAX (127)
+#define DESC_CFG_MAX (256)
+
+#define USBD_FRAME_INTERVAL_US (1000)
+#define USBD_SOF_TIMEOUT_US (3 * USBD_FRAME_INTERVAL_US)
+#define USBD_FRAME_COUNT_MASK (0x7FF)
+#define USBD_POLL_INTERVAL_MAX (8)
+#define USBD_RECONNECT_DELAY_US (100 * 1000)
 
 static usb_mode_t usbd_mode = USB_MODE_DEBUG;
 static usbd_driver_t usbd_driver = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
 static usbd_player_led_cb_t usbd_player_led_cb = NULL;
 static usbd_slider_led_cb_t usbd_slider_led_cb = NULL;
 static usbd_button_led_cb_t usbd_button_led_cb = NULL;
+static usbd_report_complete_cb_t usbd_report_complete_cb = NULL;
+
+// Copy of the drivers class driver with our SOF handler hooked in.
+static usbd_class_driver_t usbd_app_driver = {};
+
+// Written from the SOF handler in interrupt context.
+static volatile uint32_t usbd_sof_us = 0;
+static volatile uint32_t usbd_sof_frame = 0;
+static volatile uint32_t usbd_sof_count = 0;
+static volatile uint32_t usbd_xfer_frame = 0; // Frame of the last completed IN transfer
+
+static uint16_t usbd_send_offset_us = 500;
+
+// Polling interval in frames, always a power of two so it evenly divides the frame counter range.
+static uint8_t usbd_poll_interval = 1;
+static uint8_t usbd_desc_cfg[DESC_CFG_MAX] = {};
+
+// Set while the device is detached for a mode switch.
+static bool usbd_reconnect_pending = false;
+static uint32_t usbd_disconnect_us = 0;
+
+static struct {
+    uint32_t last_send_us;
+    uint32_t last_send_frame;
+    uint32_t last_poll_frame;
+    bool awaiting_completion;
+
+    uint32_t sof_count_base;
+    uint32_t reports;
+    uint32_t phase_sum_us;
+    uint16_t phase_min_us;
+    uint16_t phase_max_us;
+    uint32_t polls;
+    uint32_t poll_sum_us;
+    uint16_t poll_min_us;
+    uint16_t poll_max_us;
+} usbd_report_timing = {0, UINT32_MAX, 0, false, 0, 0, 0, UINT16_MAX, 0, 0, 0, UINT16_MAX, 0};
 
 #define USBD_SERIAL_STR_SIZE (PICO_UNIQUE_BOARD_ID_SIZE_BYTES * 2 + 1 + 3)
 static char usbd_serial_str[USBD_SERIAL_STR_SIZE] = {};
@@ -33,7 +83,42 @@ char *const usbd_desc_str[] = {
     [USBD_STR_SERIAL] = usbd_serial_str,         //
 };
 
-void usbd_driver_init(usb_mode_t mode) {
+// Called in interrupt context on every start-of-frame, so only take a timestamp here.
+// Actual report submission happens from the main loop since the endpoint API is not
+// safe to use from interrupts.
+static void DIVACON_HOT_PATH usbd_driver_sof_cb(uint8_t rhport, uint32_t frame_count) {
+    usbd_sof_us = time_us_32();
+    usbd_sof_frame = frame_count;
+    usbd_sof_count++;
+
+    if (usbd_driver.app_driver->sof) {
+        usbd_driver.app_driver->sof(rhport, frame_count);
+    }
+}
+
+// TinyUSB's event handler is wrapped at link time (--wrap=dcd_event_handler) to note the frame in which IN transfers
+// complete. It runs in interrupt context, the transfer callbacks only later from tud_task(), possibly frames after
+// the host polled.
+void __real_dcd_event_handler(dcd_event_t const *event, bool in_isr);
+
+void DIVACON_HOT_PATH __wrap_dcd_event_handler(dcd_event_t const *event, bool in_isr) {
+    if (event->event_id == DCD_EVENT_XFER_COMPLETE && tu_edpt_dir(event->xfer_complete.ep_addr) == TUSB_DIR_IN &&
+        tu_edpt_number(event->xfer_complete.ep_addr) != 0) {
+        usbd_xfer_frame = usb_hw->sof_rd & USB_SOF_RD_BITS;
+    }
+
+    __real_dcd_event_handler(event, in_isr);
+}
+
+// Number of frames from `frame` until the next frame in which the host is expected to poll,
+// derived from the frame of the last completed transfer. In the range 1..usbd_poll_interval.
+static uint32_t DIVACON_HOT_PATH usbd_frames_until_poll(uint32_t frame) {
+    const uint32_t since_poll = (frame - usbd_report_timing.last_poll_frame) & USBD_FRAME_COUNT_MASK;
+
+    return usbd_poll_interval - (since_poll & (usbd_poll_interval - 1));
+}
+
+static void usbd_driver_select(usb_mode_t mode) {
     usbd_mode = mode;
 
     switch (mode) {
@@ -72,34 +157,211 @@ void usbd_driver_init(usb_mode_t mode) {
         break;
     }
 
+    // Descriptors are const, patch the polling interval into a copy.
+    if (usbd_desc_cfg_set_interval(usbd_desc_cfg, sizeof(usbd_desc_cfg), usbd_driver.desc_cfg, usbd_poll_interval)) {
+        usbd_driver.desc_cfg = usbd_desc_cfg;
+    }
+
+    usbd_app_driver = *usbd_driver.app_driver;
+    usbd_app_driver.sof = usbd_driver_sof_cb;
+
+    // Strings contain the mode, rebuild them on the next request.
+    usbd_serial_str[0] = '\0';
+    usbd_product_str[0] = '\0';
+
+    usbd_report_timing.last_send_frame = UINT32_MAX;
+    usbd_report_timing.last_poll_frame = 0;
+    usbd_report_timing.awaiting_completion = false;
+}
+
+void usbd_driver_init(usb_mode_t mode) {
+    usbd_driver_select(mode);
+
     tud_init(BOARD_TUD_RHPORT);
+    tud_sof_cb_enable(true);
+}
+
+// Tears down the stack and detaches from the host, which will enumerate the device in
+// its new mode after usbd_driver_task() reconnected it.
+void usbd_driver_switch_mode(usb_mode_t mode) {
+    tud_disconnect();
+    tud_deinit(BOARD_TUD_RHPORT);
+
+    usbd_driver_select(mode);
+
+    usbd_disconnect_us = time_us_32();
+    usbd_reconnect_pending = true;
 }
 
-void usbd_driver_task() { tud_task(); }
+void DIVACON_HOT_PATH usbd_driver_task() {
+    if (usbd_reconnect_pending) {
+        // Stay detached long enough for the host to notice.
+        if (time_us_32() - usbd_disconnect_us < USBD_RECONNECT_DELAY_US) {
+            return;
+        }
+        usbd_reconnect_pending = false;
+
+        tud_init(BOARD_TUD_RHPORT);
+        tud_sof_cb_enable(true);
+    }
+
+    tud_task();
+}
 
 usb_mode_t usbd_driver_get_mode() { return usbd_mode; }
 
-void usbd_driver_send_report(usb_report_t report) {
-    static const uint64_t interval_us = 900;
-    static uint64_t start_us = 0;
+bool DIVACON_HOT_PATH usbd_driver_send_report(usb_report_t report) {
+    if (usbd_reconnect_pending) {
+        return false;
+    }
 
-    if (to_us_since_boot(get_absolute_time()) - start_us <= interval_us) {
-        return;
+    const uint32_t now = time_us_32();
+
+    const uint32_t interrupts = save_and_disable_interrupts();
+    const uint32_t sof_us = usbd_sof_us;
+    const uint32_t sof_frame = usbd_sof_frame;
+    const uint32_t sof_count = usbd_sof_count;
+    restore_interrupts(interrupts);
+
+    const uint32_t since_sof_us = now - sof_us;
+    const bool sof_active = sof_count != 0 && since_sof_us < USBD_SOF_TIMEOUT_US;
+
+    if (sof_active) {
+        // Submit once per polling interval in the frame before the host polls, as late as possible.
+        if (sof_frame == usbd_report_timing.last_send_frame || usbd_frames_until_poll(sof_frame) != 1 ||
+            since_sof_us < usbd_send_offset_us) {
+            return false;
+        }
+    } else {
+        // No SOF seen (suspended or not yet enumerated), fall back to a free-running interval.
+        if (now - usbd_report_timing.last_send_us < usbd_poll_interval * USBD_FRAME_INTERVAL_US) {
+            return false;
+        }
     }
-    start_us += interval_us;
 
     if (tud_suspended()) {
         tud_remote_wakeup();
     }
 
-    if (usbd_driver.send_report) {
-        usbd_driver.send_report(report);
+    if (!usbd_driver.send_report || !usbd_driver.send_report(report)) {
+        return false;
+    }
+
+    usbd_report_timing.last_send_us = now;
+    usbd_report_timing.last_send_frame = sof_frame;
+    usbd_report_timing.awaiting_completion = true;
+    usbd_report_timing.reports++;
+
+    if (sof_active) {
+        const uint16_t phase_us = since_sof_us;
+
+        usbd_report_timing.phase_sum_us += phase_us;
+        usbd_report_timing.phase_min_us = TU_MIN(usbd_report_timing.phase_min_us, phase_us);
+        usbd_report_timing.phase_max_us = TU_MAX(usbd_report_timing.phase_max_us, phase_us);
+    }
+
+    return true;
+}
+
+// To be called by the drivers when an input report transfer has completed. Since this
+// is called from task context, the measured time is an upper bound for when the host
+// actually picked up the report. The poll frame is the one captured when the transfer
+// completed in interrupt context.
+void DIVACON_HOT_PATH usbd_driver_report_complete() {
+    if (!usbd_report_timing.awaiting_completion) {
+        return;
+    }
+    usbd_report_timing.awaiting_completion = false;
+    usbd_report_timing.last_poll_frame = usbd_xfer_frame;
+
+    const uint32_t poll_us = time_us_32() - usbd_report_timing.last_send_us;
+    const uint16_t poll_us_clamped = TU_MIN(poll_us, UINT16_MAX);
+
+    usbd_report_timing.polls++;
+    usbd_report_timing.poll_sum_us += poll_us_clamped;
+    usbd_report_timing.poll_min_us = TU_MIN(usbd_report_timing.poll_min_us, poll_us_clamped);
+    usbd_report_timing.poll_max_us = TU_MAX(usbd_report_timing.poll_max_us, poll_us_clamped);
+
+    if (usbd_report_complete_cb) {
+        usbd_report_complete_cb();
+    }
+}
+
+void usbd_driver_set_send_offset(uint16_t offset_us) {
+    usbd_send_offset_us = TU_MIN(offset_us, USBD_FRAME_INTERVAL_US - 1);
+}
+
+// Needs to be set before usbd_driver_init() or usbd_driver_switch_mode() since it ends up in the
+// configuration descriptor.
+// Rounded down to a power of two.
+void usbd_driver_set_poll_interval(uint8_t interval_ms) {
+    uint8_t interval = 1;
+    while ((interval << 1) <= TU_MIN(interval_ms, USBD_POLL_INTERVAL_MAX)) {
+        interval <<= 1;
+    }
+
+    usbd_poll_interval = interval;
+}
+
+uint8_t usbd_driver_get_poll_interval() { return usbd_poll_interval; }
+
+// Whether a host is configured and currently polling for reports.
+bool usbd_driver_is_polled() { return !usbd_reconnect_pending && tud_mounted() && !tud_suspended(); }
+
+// Latest point in time at which the next report should be queued to be picked up
+// by the next host poll. Returns false if there is no SOF to synchronize to.
+bool DIVACON_HOT_PATH usbd_driver_get_send_deadline(uint32_t *deadline_us) {
+    const uint32_t interrupts = save_and_disable_interrupts();
+    const uint32_t sof_us = usbd_sof_us;
+    const uint32_t sof_frame = usbd_sof_frame;
+    const uint32_t sof_count = usbd_sof_count;
+    restore_interrupts(interrupts);
+
+    if (sof_count == 0 || time_us_32() - sof_us >= USBD_SOF_TIMEOUT_US) {
+        return false;
+    }
+
+    uint32_t frames = usbd_frames_until_poll(sof_frame);
+    if (sof_frame == usbd_report_timing.last_send_frame) {
+        frames += usbd_poll_interval;
     }
+    *deadline_us = sof_us + frames * USBD_FRAME_INTERVAL_US;
+
+    return true;
+}
+
+void usbd_driver_get_report_timing(usbd_report_timing_t *timing) {
+    const uint32_t sof_count = usbd_sof_count;
+    const uint32_t frames = sof_count - usbd_report_timing.sof_count_base;
+    const uint32_t intervals = frames / usbd_poll_interval;
+
+    timing->frames = frames;
+    timing->reports = usbd_report_timing.reports;
+    timing->skipped_frames = intervals > usbd_report_timing.reports ? intervals - usbd_report_timing.reports : 0;
+
+    timing->phase_min_us = usbd_report_timing.reports ? usbd_report_timing.phase_min_us : 0;
+    timing->phase_max_us = usbd_report_timing.phase_max_us;
+    timing->phase_avg_us = usbd_report_timing.reports ? usbd_report_timing.phase_sum_us / usbd_report_timing.reports : 0;
+
+    timing->poll_min_us = usbd_report_timing.polls ? usbd_report_timing.poll_min_us : 0;
+    timing->poll_max_us = usbd_report_timing.poll_max_us;
+    timing->poll_avg_us = usbd_report_timing.polls ? usbd_report_timing.poll_sum_us / usbd_report_timing.polls : 0;
+
+    usbd_report_timing.sof_count_base = sof_count;
+    usbd_report_timing.reports = 0;
+    usbd_report_timing.phase_sum_us = 0;
+    usbd_report_timing.phase_min_us = UINT16_MAX;
+    usbd_report_timing.phase_max_us = 0;
+    usbd_report_timing.polls = 0;
+    usbd_report_timing.poll_sum_us = 0;
+    usbd_report_timing.poll_min_us = UINT16_MAX;
+    usbd_report_timing.poll_max_us = 0;
 }
 
 void usbd_driver_set_player_led_cb(usbd_player_led_cb_t cb) { usbd_player_led_cb = cb; };
 void usbd_driver_set_slider_led_cb(usbd_slider_led_cb_t cb) { usbd_slider_led_cb = cb; };
 void usbd_driver_set_button_led_cb(usbd_button_led_cb_t cb) { usbd_button_led_cb = cb; };
+void usbd_driver_set_report_complete_cb(usbd_report_complete_cb_t cb) { usbd_report_complete_cb = cb; };
 
 usbd_player_led_cb_t usbd_driver_get_player_led_cb() { return usbd_player_led_cb; };
 usbd_slider_led_cb_t usbd_driver_get_slider_led_cb() { return usbd_slider_led_cb; };
@@ -159,5 +421,5 @@ uint8_t const *tud_descriptor_bos_cb(void) { return usbd_driver.desc_bos; }
 // Implement callback to add our custom driver
 const usbd_class_driver_t *usbd_app_driver_get_cb(uint8_t *driver_count) {
     *driver_count = 1;
-    return usbd_driver.app_driver;
+    return &usbd_app_driver;
 }
@@ -0,0 +1,78 @@
+#include "utils/InputPhaseLock.h"
+
+#include "usb/device_driver.h"
+#include "utils/HotPath.h"
+
+#include "pico/time.h"
+
+namespace Divacon::Utils {
+
+namespace {
+const static uint32_t age_bucket_width_us = 50;
+} // namespace
+
+InputPhaseLock::InputPhaseLock(const Config &config)
+    : m_config(config), m_scan_estimate_us(0), m_sample_start_us(0), m_submitted_sample_us(0),
+      m_awaiting_completion(false), m_age_histogram(age_bucket_width_us) {}
+
+void DIVACON_HOT_PATH InputPhaseLock::waitForSampleWindow() {
+    if (!m_config.enabled) {
+        return;
+    }
+
+    // Upper bound for waiting, in case SOFs stop arriving while we wait.
+    const uint32_t max_wait_us = (usbd_driver_get_poll_interval() + 1) * 1000;
+    const uint32_t wait_start = time_us_32();
+    uint32_t deadline_us;
+
+    // Keep servicing USB while waiting. The deadline is re-read on every iteration
+    // since a new SOF might arrive in between.
+    while (usbd_driver_get_send_deadline(&deadline_us)) {
+        const uint32_t now = time_us_32();
+        const uint32_t sample_at = deadline_us - m_config.margin_us - m_scan_estimate_us;
+
+        if ((int32_t)(now - sample_at) >= 0 || (now - wait_start) > max_wait_us) {
+            break;
+        }
+
+        usbd_driver_task();
+    }
+}
+
+void InputPhaseLock::beginSample() { m_sample_start_us = time_us_32(); }
+
+void DIVACON_HOT_PATH InputPhaseLock::endSample() {
+    const uint32_t duration = time_us_32() - m_sample_start_us;
+
+    // Follow increases immediately, decay slowly to stay on the safe side.
+    if (duration > m_scan_estimate_us) {
+        m_scan_estimate_us = duration;
+    } else {
+        m_scan_estimate_us -= (m_scan_estimate_us - duration) >> 4;
+    }
+}
+
+void DIVACON_HOT_PATH InputPhaseLock::reportSubmitted() {
+    m_submitted_sample_us = m_sample_start_us;
+    m_awaiting_completion = true;
+}
+
+void DIVACON_HOT_PATH InputPhaseLock::reportCompleted() {
+    if (!m_awaiting_completion) {
+        return;
+    }
+    m_awaiting_completion = false;
+
+    if (m_config.measure_age) {
+        m_age_histogram.add(time_us_32() - m_submitted_sample_us);
+    }
+}
+
+LatencyHistogram::Summary InputPhaseLock::getAgeSummary() {
+    const auto summary = m_age_histogram.getSummary();
+    m_age_histogram.reset();
+
+    return summary;
+}
+
+} // namespace Divacon::Utils
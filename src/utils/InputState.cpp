@@ -1,8 +1,9 @@
 #include "utils/InputState.h"
 
-#include <bitset>
-#include <iomanip>
-#include <sstream>
+#include "utils/HotPath.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace Divacon::Utils {
 
@@ -12,9 +13,9 @@ InputState::InputState()
       sticks({{AnalogStick::center, AnalogStick::center}, {AnalogStick::center, AnalogStick::center}}),     //
       touches(0), m_switch_report({}), m_ps3_report({}), m_ps4_report({}), m_keyboard_report({}),
       m_xinput_report({0x00, sizeof(xinput_report_t), 0, 0, 0, 0, 0, 0, 0, 0, {}}), m_pdloader_report({}),
-      m_midi_report({false, false, false, false, 60, 0, 64, false, false}) {}
+      m_midi_report({false, false, false, false, 60, 0, 64, false, false}), m_debug_report({}) {}
 
-usb_report_t InputState::getReport(usb_mode_t mode) {
+usb_report_t DIVACON_HOT_PATH InputState::getReport(usb_mode_t mode) {
     switch (mode) {
     case USB_MODE_SWITCH_DIVACON:
     case USB_MODE_SWITCH_HORIPAD:
@@ -41,7 +42,7 @@ usb_report_t InputState::getReport(usb_mode_t mode) {
 
 InputState::InputMessage InputState::getInputMessage() { return {buttons, touches}; }
 
-static uint8_t getHidHat(const InputState::DPad dpad) {
+static uint8_t DIVACON_HOT_PATH getHidHat(const InputState::DPad dpad) {
     if (dpad.up && dpad.right) {
         return 0x01;
     } else if (dpad.down && dpad.right) {
@@ -63,7 +64,7 @@ static uint8_t getHidHat(const InputState::DPad dpad) {
     return 0x08;
 }
 
-usb_report_t InputState::getSwitchReport() {
+usb_report_t DIVACON_HOT_PATH InputState::getSwitchReport() {
     m_switch_report.buttons = 0                                 //
                               | (buttons.west ? (1 << 0) : 0)   //
                               | (buttons.south ? (1 << 1) : 0)  //
@@ -89,7 +90,7 @@ usb_report_t InputState::getSwitchReport() {
     return {(uint8_t *)&m_switch_report, sizeof(hid_switch_report_t)};
 }
 
-usb_report_t InputState::getPS3InputReport() {
+usb_report_t DIVACON_HOT_PATH InputState::getPS3InputReport() {
     memset(&m_ps3_report, 0, sizeof(m_ps3_report));
 
     m_ps3_report.report_id = 0x01;
@@ -140,7 +141,7 @@ usb_report_t InputState::getPS3InputReport() {
     return {(uint8_t *)&m_ps3_report, sizeof(hid_ps3_report_t)};
 }
 
-usb_report_t InputState::getPS4InputReport() {
+usb_report_t DIVACON_HOT_PATH InputState::getPS4InputReport() {
     static uint8_t report_counter = 0;
 
     memset(&m_ps4_report, 0, sizeof(m_ps4_report));
@@ -188,7 +189,7 @@ usb_report_t InputState::getPS4InputReport() {
     return {(uint8_t *)&m_ps4_report, sizeof(hid_ps4_report_t)};
 }
 
-usb_report_t InputState::getXinputReport() {
+usb_report_t DIVACON_HOT_PATH InputState::getXinputReport() {
     m_xinput_report.buttons1 = 0                                 //
                                | (dpad.up ? (1 << 0) : 0)        //
                                | (dpad.down ? (1 << 1) : 0)      //
@@ -219,7 +220,7 @@ usb_report_t InputState::getXinputReport() {
     return {(uint8_t *)&m_xinput_report, sizeof(xinput_report_t)};
 }
 
-usb_report_t InputState::getPDLoaderReport() {
+usb_report_t DIVACON_HOT_PATH InputState::getPDLoaderReport() {
     m_pdloader_report.vendor[0] = 0x42;
     m_pdloader_report.vendor[1] = 0x56;
     m_pdloader_report.vendor[2] = 0x5a;
@@ -255,7 +256,7 @@ usb_report_t InputState::getPDLoaderReport() {
     return {(uint8_t *)&m_pdloader_report, sizeof(pdloader_report_t)};
 }
 
-usb_report_t InputState::getKeyboardReport() {
+usb_report_t DIVACON_HOT_PATH InputState::getKeyboardReport() {
     m_keyboard_report = {.keycodes = {0}};
 
     auto set_key = [&](const bool input, const uint8_t keycode) {
@@ -294,7 +295,7 @@ usb_report_t InputState::getKeyboardReport() {
     return {(uint8_t *)&m_keyboard_report, sizeof(hid_nkro_keyboard_report_t)};
 }
 
-usb_report_t InputState::getMidiReport() {
+usb_report_t DIVACON_HOT_PATH InputState::getMidiReport() {
     static bool last_shift_down = false;
     static bool last_shift_up = false;
 
@@ -328,36 +329,99 @@ usb_report_t InputState::getMidiReport() {
     return {(uint8_t *)&m_midi_report, sizeof(midi_report_t)};
 }
 
-usb_report_t InputState::getDebugReport() {
-    std::stringstream out;
-
-    out << "Dpad: "                                                                   //
-        << (dpad.up ? "U" : " ") << (dpad.down ? "D" : " ")                           //
-        << (dpad.left ? "L" : " ") << (dpad.right ? "R" : " ") << " "                 //
-        << "Buttons: "                                                                //
-        << "N: " << buttons.north << " "                                              //
-        << "E: " << buttons.east << " "                                               //
-        << "S: " << buttons.south << " "                                              //
-        << "W: " << buttons.west << " "                                               //
-        << "L1: " << buttons.l1 << " "                                                //
-        << "L2: " << buttons.l2 << " "                                                //
-        << "L3: " << buttons.l3 << " "                                                //
-        << "R1: " << buttons.r1 << " "                                                //
-        << "R2: " << buttons.r2 << " "                                                //
-        << "R3: " << buttons.r3 << " "                                                //
-        << "START: " << buttons.start << " "                                          //
-        << "SELECT: " << buttons.select << " "                                        //
-        << "HOME: " << buttons.home << " "                                            //
-        << "LX: " << std::setw(3) << static_cast<unsigned int>(sticks.left.x) << " "  //
-        << "LY: " << std::setw(3) << static_cast<unsigned int>(sticks.left.y) << " "  //
-        << "RX: " << std::setw(3) << static_cast<unsigned int>(sticks.right.x) << " " //
-        << "RY: " << std::setw(3) << static_cast<unsigned int>(sticks.right.y) << " " //
-        << "TOUCH: " << std::bitset<32>(touches)                                      //
-        << "\r";
-
-    m_debug_report = out.str();
-
-    return {(uint8_t *)m_debug_report.c_str(), static_cast<uint16_t>(m_debug_report.size() + 1)};
+namespace {
+
+// Minimal non-allocating formatter for the debug report, the output needs
+// to be regenerated every loop iteration so we avoid iostreams here.
+class DebugReportWriter {
+  private:
+    char *m_buffer;
+    size_t m_capacity;
+    size_t m_pos;
+
+    void put(char c) {
+        if (m_pos < m_capacity - 1) {
+            m_buffer[m_pos++] = c;
+        }
+    }
+
+  public:
+    DebugReportWriter(char *buffer, size_t capacity) : m_buffer(buffer), m_capacity(capacity), m_pos(0) {}
+
+    DebugReportWriter &str(const char *str) {
+        while (*str) {
+            put(*str++);
+        }
+        return *this;
+    }
+
+    DebugReportWriter &flag(bool value, char set) {
+        put(value ? set : ' ');
+        return *this;
+    }
+
+    DebugReportWriter &field(const char *name, bool value) {
+        str(name).str(": ");
+        put(value ? '1' : '0');
+        put(' ');
+        return *this;
+    }
+
+    DebugReportWriter &field(const char *name, uint8_t value) {
+        str(name).str(": ");
+        put(value >= 100 ? '0' + (value / 100) : ' ');
+        put(value >= 10 ? '0' + ((value / 10) % 10) : ' ');
+        put('0' + (value % 10));
+        put(' ');
+        return *this;
+    }
+
+    DebugReportWriter &bits(const char *name, uint32_t value) {
+        str(name).str(": ");
+        for (uint32_t mask = 0x80000000; mask; mask >>= 1) {
+            put((value & mask) ? '1' : '0');
+        }
+        return *this;
+    }
+
+    uint16_t finish() {
+        m_buffer[m_pos] = '\0';
+        return m_pos + 1;
+    }
+};
+
+} // namespace
+
+usb_report_t DIVACON_HOT_PATH InputState::getDebugReport() {
+    DebugReportWriter out(m_debug_report.data(), m_debug_report.size());
+
+    out.str("Dpad: ")                         //
+        .flag(dpad.up, 'U')                   //
+        .flag(dpad.down, 'D')                 //
+        .flag(dpad.left, 'L')                 //
+        .flag(dpad.right, 'R')                //
+        .str(" Buttons: ")                    //
+        .field("N", buttons.north)            //
+        .field("E", buttons.east)             //
+        .field("S", buttons.south)            //
+        .field("W", buttons.west)             //
+        .field("L1", buttons.l1)              //
+        .field("L2", buttons.l2)              //
+        .field("L3", buttons.l3)              //
+        .field("R1", buttons.r1)              //
+        .field("R2", buttons.r2)              //
+        .field("R3", buttons.r3)              //
+        .field("START", buttons.start)        //
+        .field("SELECT", buttons.select)      //
+        .field("HOME", buttons.home)          //
+        .field("LX", sticks.left.x)           //
+        .field("LY", sticks.left.y)           //
+        .field("RX", sticks.right.x)          //
+        .field("RY", sticks.right.y)          //
+        .bits("TOUCH", touches)               //
+        .str("\r");
+
+    return {(uint8_t *)m_debug_report.data(), out.finish()};
 }
 
 void InputState::releaseAll() {
@@ -367,7 +431,7 @@ void InputState::releaseAll() {
     touches = 0;
 }
 
-bool InputState::checkHotkey() {
+bool DIVACON_HOT_PATH InputState::checkHotkey() {
     static uint32_t hold_since = 0;
     static bool hold_active = false;
     static const uint32_t hold_timeout = 2000;
@@ -0,0 +1,47 @@
+#include "utils/LatencyHistogram.h"
+
+#include <algorithm>
+
+namespace Divacon::Utils {
+
+LatencyHistogram::LatencyHistogram(uint32_t bucket_width_us)
+    : m_bucket_width_us(std::max(bucket_width_us, (uint32_t)1)), m_buckets({}), m_count(0), m_max_us(0) {}
+
+void LatencyHistogram::add(uint32_t latency_us) {
+    // Everything beyond the last bucket is accounted to the last bucket.
+    const size_t bucket = std::min(latency_us / m_bucket_width_us, (uint32_t)(BUCKET_COUNT - 1));
+
+    m_buckets[bucket]++;
+    m_count++;
+    m_max_us = std::max(m_max_us, latency_us);
+}
+
+void LatencyHistogram::reset() {
+    m_buckets.fill(0);
+    m_count = 0;
+    m_max_us = 0;
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t percent) const {
+    if (m_count == 0) {
+        return 0;
+    }
+
+    // Report the upper edge of the bucket containing the requested rank.
+    const uint32_t rank = ((uint64_t)m_count * percent + 99) / 100;
+    uint32_t accumulated = 0;
+    for (size_t idx = 0; idx < BUCKET_COUNT; ++idx) {
+        accumulated += m_buckets[idx];
+        if (accumulated >= rank) {
+            return std::min((uint32_t)(idx + 1) * m_bucket_width_us, m_max_us);
+        }
+    }
+
+    return m_max_us;
+}
+
+LatencyHistogram::Summary LatencyHistogram::getSummary() const {
+    return {m_count, percentile(50), percentile(90), percentile(99), m_max_us};
+}
+
+} // namespace Divacon::Utils
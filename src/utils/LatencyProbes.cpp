@@ -0,0 +1,86 @@
+#include "utils/LatencyProbes.h"
+
+#if DIVACON_LATENCY_PROBES
+
+#include "pico/time.h"
+
+#include <array>
+
+namespace Divacon::Utils::LatencyProbes {
+
+namespace {
+
+const static size_t span_count = static_cast<size_t>(Span::Count);
+
+const static std::array<const char *, span_count> span_names = {
+    "debounce", "touch", "build", "queue", "xfer", "total",
+};
+
+std::array<LatencyHistogram, span_count> histograms = {
+    LatencyHistogram(250), // Debounce
+    LatencyHistogram(25),  // TouchScan
+    LatencyHistogram(10),  // ReportBuild
+    LatencyHistogram(50),  // Queueing
+    LatencyHistogram(50),  // Transfer
+    LatencyHistogram(100), // Total
+};
+
+uint32_t sample_us = 0;
+uint32_t touch_frame_us = 0;
+uint32_t report_built_us = 0;
+
+// Timestamps of the report currently in flight.
+uint32_t submitted_sample_us = 0;
+uint32_t submitted_us = 0;
+bool in_flight = false;
+
+} // namespace
+
+void mark(Stage stage) {
+    const uint32_t now = time_us_32();
+
+    switch (stage) {
+    case Stage::GpioSample:
+        sample_us = now;
+        break;
+    case Stage::TouchFrame:
+        touch_frame_us = now;
+        record(Span::TouchScan, now - sample_us);
+        break;
+    case Stage::ReportBuilt:
+        report_built_us = now;
+        record(Span::ReportBuild, now - touch_frame_us);
+        break;
+    case Stage::ReportSubmitted:
+        record(Span::Queueing, now - report_built_us);
+        submitted_sample_us = sample_us;
+        submitted_us = now;
+        in_flight = true;
+        break;
+    case Stage::TransferComplete:
+        if (in_flight) {
+            record(Span::Transfer, now - submitted_us);
+            record(Span::Total, now - submitted_sample_us);
+            in_flight = false;
+        }
+        break;
+    }
+}
+
+void record(Span span, uint32_t duration_us) { histograms[static_cast<size_t>(span)].add(duration_us); }
+
+const char *getName(Span span) { return span_names[static_cast<size_t>(span)]; }
+
+const LatencyHistogram &getHistogram(Span span) { return histograms[static_cast<size_t>(span)]; }
+
+LatencyHistogram::Summary getSummary(Span span) { return histograms[static_cast<size_t>(span)].getSummary(); }
+
+void reset() {
+    for (auto &histogram : histograms) {
+        histogram.reset();
+    }
+}
+
+} // namespace Divacon::Utils::LatencyProbes
+
+#endif // DIVACON_LATENCY_PROBES
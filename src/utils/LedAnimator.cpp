@@ -0,0 +1,164 @@
+#include "utils/LedAnimator.h"
+
+#include "utils/HotPath.h"
+
+#include <algorithm>
+
+namespace Divacon::Utils {
+
+namespace {
+
+const static uint32_t blend_step_count = 128;
+
+LedAnimator::Color max_color(const LedAnimator::Color &a, const LedAnimator::Color &b) {
+    return LedAnimator::Color{
+        .r = std::max(a.r, b.r),
+        .g = std::max(a.g, b.g),
+        .b = std::max(a.b, b.b),
+    };
+}
+
+} // namespace
+
+LedAnimator::LedAnimator(const Effect &idle_effect, const Effect &touched_effect, uint32_t seed)
+    : m_idle_layer({}), m_touched_layer({}), m_touched(0), m_blend_steps(0), m_blend_percent(100), m_frame({}) {
+    m_idle_layer.effect = &idle_effect;
+    m_idle_layer.palette_position = seed;
+    m_touched_layer.effect = &touched_effect;
+}
+
+uint32_t LedAnimator::toScale(uint32_t numerator, uint32_t denominator) {
+    return (numerator * 65536 + denominator - 1) / denominator;
+}
+
+uint8_t LedAnimator::scale(uint8_t value, uint32_t scale) { return (value * scale) >> 16; }
+
+LedAnimator::Color LedAnimator::dim(const Color &color, uint32_t scale) {
+    return Color{
+        .r = LedAnimator::scale(color.r, scale),
+        .g = LedAnimator::scale(color.g, scale),
+        .b = LedAnimator::scale(color.b, scale),
+    };
+}
+
+void LedAnimator::setIdleEffect(const Effect &effect) { m_idle_layer.effect = &effect; }
+void LedAnimator::setTouchedEffect(const Effect &effect) { m_touched_layer.effect = &effect; }
+
+// Returns how many whole `step_count`s have passed, the rest is carried over in `current_steps`.
+uint32_t DIVACON_HOT_PATH LedAnimator::advance(uint32_t &current_steps, uint32_t steps, uint32_t step_count) {
+    if (step_count == 0) {
+        return 0;
+    }
+
+    current_steps += steps;
+    if (current_steps < step_count) {
+        return 0;
+    }
+
+    const auto advance = current_steps / step_count;
+
+    current_steps %= step_count;
+
+    return advance;
+}
+
+uint8_t DIVACON_HOT_PATH LedAnimator::getLevel(Layer &layer, uint32_t steps) {
+    const auto &effect = *layer.effect;
+
+    if (effect.keyframe_count == 0) {
+        return 100;
+    }
+
+    const uint32_t period = effect.keyframes[effect.keyframe_count - 1].time;
+    if (effect.keyframe_count == 1 || period == 0) {
+        return effect.keyframes[0].level_percent;
+    }
+
+    layer.level_position =
+        (layer.level_position + advance(layer.level_steps, steps, effect.level_step_count)) % period;
+
+    size_t next = 1;
+    while (effect.keyframes[next].time <= layer.level_position) {
+        ++next;
+    }
+
+    const auto &from = effect.keyframes[next - 1];
+    const auto &to = effect.keyframes[next];
+
+    return from.level_percent + (static_cast<int32_t>(to.level_percent) - from.level_percent) *
+                                    static_cast<int32_t>(layer.level_position - from.time) / (to.time - from.time);
+}
+
+void DIVACON_HOT_PATH LedAnimator::updateLayer(Layer &layer, uint32_t steps) {
+    const auto &effect = *layer.effect;
+
+    const uint32_t level_scale = toScale(getLevel(layer, steps), 100);
+
+    const Palette *palette = effect.palette;
+    size_t palette_phase = 0;
+    size_t palette_offset = 0;
+    if (palette != nullptr && palette->length > 0 && palette->phases > 0) {
+        layer.palette_position =
+            (layer.palette_position + advance(layer.palette_steps, steps, effect.palette_step_count)) %
+            (palette->length * palette->phases);
+
+        palette_phase = layer.palette_position % palette->phases;
+        palette_offset = layer.palette_position / palette->phases;
+    } else {
+        palette = nullptr;
+    }
+
+    const uint32_t decay_advance = advance(layer.decay_steps, steps, effect.decay_step_count);
+
+    for (size_t idx = 0; idx < SEGMENT_COUNT; ++idx) {
+        Color source = {0x00, 0x00, 0x00};
+        switch (effect.source) {
+        case Source::Off:
+            break;
+        case Source::Color:
+            source = layer.color;
+            break;
+        case Source::Palette:
+            if (palette != nullptr) {
+                source = palette->colors[palette_phase * palette->length + (palette_offset + idx) % palette->length];
+            }
+            break;
+        case Source::Idle:
+            source = m_idle_layer.frame[idx];
+            break;
+        }
+
+        if (!effect.touched_only || (m_touched & ((uint32_t)0x80000000 >> idx))) {
+            layer.frame[idx] = dim(source, level_scale);
+            layer.decay_percent[idx] = 100;
+        } else if (effect.decay_step_count != 0) {
+            layer.frame[idx] = dim(layer.frame[idx], toScale(layer.decay_percent[idx], 100));
+            layer.decay_percent[idx] =
+                decay_advance > layer.decay_percent[idx] ? 0 : layer.decay_percent[idx] - decay_advance;
+        } else {
+            layer.frame[idx] = {0x00, 0x00, 0x00};
+        }
+    }
+}
+
+DIVACON_HOT_PATH const LedAnimator::Frame &LedAnimator::update(uint32_t steps) {
+    updateLayer(m_idle_layer, steps);
+    updateLayer(m_touched_layer, steps);
+
+    // Idle colors fade out while the slider is touched and back in afterwards.
+    const auto blend_advance = advance(m_blend_steps, steps, blend_step_count);
+    if (m_touched) {
+        m_blend_percent = blend_advance > m_blend_percent ? 0 : m_blend_percent - blend_advance;
+    } else {
+        m_blend_percent = blend_advance + m_blend_percent > 100 ? 100 : m_blend_percent + blend_advance;
+    }
+
+    const uint32_t blend_scale = toScale(m_blend_percent, 100);
+    for (size_t idx = 0; idx < SEGMENT_COUNT; ++idx) {
+        m_frame[idx] = max_color(dim(m_idle_layer.frame[idx], blend_scale), m_touched_layer.frame[idx]);
+    }
+
+    return m_frame;
+}
+
+} // namespace Divacon::Utils
@@ -2,11 +2,19 @@
 
 namespace Divacon::Utils {
 
-const std::map<Menu::Page, const Menu::Descriptor> Menu::descriptors = {
+namespace {
+
+struct PageDescriptor {
+    Menu::Page page;
+    Menu::Descriptor descriptor;
+};
+
+constexpr PageDescriptor descriptors[] = {
     {Menu::Page::Main,                                                      //
      {Menu::Descriptor::Type::Menu,                                         //
       "Settings",                                                           //
       {{"Mode", Menu::Descriptor::Action::GotoPageDeviceMode},              //
+       {"Poll Rate", Menu::Descriptor::Action::GotoPageUsbPollInterval},    //
        {"Slider LED", Menu::Descriptor::Action::GotoPageLed},               //
        {"Double Btn", Menu::Descriptor::Action::GotoPageInputMirrorToDpad}, //
        {"Reset", Menu::Descriptor::Action::GotoPageReset},                  //
@@ -27,6 +35,14 @@ const std::map<Menu::Page, const Menu::Descriptor> Menu::descriptors = {
        {"MIDI", Menu::Descriptor::Action::SetUsbMode},       //
        {"Debug", Menu::Descriptor::Action::SetUsbMode}}}},   //
 
+    {Menu::Page::UsbPollInterval,                                   //
+     {Menu::Descriptor::Type::Selection,                            //
+      "USB Poll Rate",                                              //
+      {{"1000 Hz", Menu::Descriptor::Action::SetUsbPollInterval},   //
+       {"500 Hz", Menu::Descriptor::Action::SetUsbPollInterval},    //
+       {"250 Hz", Menu::Descriptor::Action::SetUsbPollInterval},    //
+       {"125 Hz", Menu::Descriptor::Action::SetUsbPollInterval}}}}, //
+
     {Menu::Page::Led,                                                                 //
      {Menu::Descriptor::Type::Menu,                                                   //
       "Slider LED",                                                                   //
@@ -141,11 +157,23 @@ const std::map<Menu::Page, const Menu::Descriptor> Menu::descriptors = {
       {{"BOOTSEL", Menu::Descriptor::Action::None}}}}, //
 };
 
-Menu::Menu(std::shared_ptr<SettingsStore> settings_store)
-    : m_store(settings_store), m_active(false), m_state_stack({{Page::Main, 0, 0}}) {};
+} // namespace
+
+const Menu::Descriptor *Menu::findDescriptor(Menu::Page page) {
+    for (const auto &entry : descriptors) {
+        if (entry.page == page) {
+            return &entry.descriptor;
+        }
+    }
+    return nullptr;
+}
+
+Menu::Menu(SettingsStore &settings_store)
+    : m_store(settings_store), m_active(false), m_state_stack({{{Page::Main, 0, 0}}}), m_state_depth(1) {};
 
 void Menu::activate() {
-    m_state_stack = std::stack<State>({{Page::Main, 0, 0}});
+    m_state_stack[0] = {Page::Main, 0, 0};
+    m_state_depth = 1;
     m_active = true;
 }
 
@@ -216,36 +244,49 @@ static InputState::Buttons checkPressed(const InputState &input_state) {
     return result;
 }
 
+// Poll rate selections are powers of two, starting at 1ms.
+static uint8_t pollIntervalToSelection(uint8_t interval_ms) {
+    uint8_t selection = 0;
+    while (selection < 3 && (1 << (selection + 1)) <= interval_ms) {
+        selection++;
+    }
+    return selection;
+}
+
+static uint8_t selectionToPollInterval(uint8_t selection) { return 1 << selection; }
+
 uint8_t Menu::getCurrentValue(Menu::Page page) {
     switch (page) {
     case Page::DeviceMode:
-        return static_cast<uint8_t>(m_store->getUsbMode());
+        return static_cast<uint8_t>(m_store.getUsbMode());
+    case Page::UsbPollInterval:
+        return pollIntervalToSelection(m_store.getUsbPollInterval(m_store.getUsbMode()));
     case Page::LedBrightness:
-        return m_store->getLedBrightness();
+        return m_store.getLedBrightness();
     case Page::LedAnimationSpeed:
-        return m_store->getLedAnimationSpeed();
+        return m_store.getLedAnimationSpeed();
     case Page::LedIdleMode:
-        return static_cast<uint8_t>(m_store->getLedIdleMode());
+        return static_cast<uint8_t>(m_store.getLedIdleMode());
     case Page::LedIdleColorRed:
-        return m_store->getLedIdleColor().r;
+        return m_store.getLedIdleColor().r;
     case Page::LedIdleColorGreen:
-        return m_store->getLedIdleColor().g;
+        return m_store.getLedIdleColor().g;
     case Page::LedIdleColorBlue:
-        return m_store->getLedIdleColor().b;
+        return m_store.getLedIdleColor().b;
     case Page::LedTouchedMode:
-        return static_cast<uint8_t>(m_store->getLedTouchedMode());
+        return static_cast<uint8_t>(m_store.getLedTouchedMode());
     case Page::LedTouchedColorRed:
-        return m_store->getLedTouchedColor().r;
+        return m_store.getLedTouchedColor().r;
     case Page::LedTouchedColorGreen:
-        return m_store->getLedTouchedColor().g;
+        return m_store.getLedTouchedColor().g;
     case Page::LedTouchedColorBlue:
-        return m_store->getLedTouchedColor().b;
+        return m_store.getLedTouchedColor().b;
     case Page::LedEnablePlayerColor:
-        return m_store->getLedEnablePlayerColor();
+        return m_store.getLedEnablePlayerColor();
     case Page::LedEnablePdloaderSupport:
-        return m_store->getLedEnablePdloaderSupport();
+        return m_store.getLedEnablePdloaderSupport();
     case Page::InputMirrorToDpad:
-        return m_store->getInputMirrorToDpad();
+        return m_store.getInputMirrorToDpad();
     case Page::Main:
     case Page::Led:
     case Page::LedIdleColor:
@@ -262,11 +303,13 @@ uint8_t Menu::getCurrentValue(Menu::Page page) {
 void Menu::gotoPage(Menu::Page page) {
     const auto current_value = getCurrentValue(page);
 
-    m_state_stack.push({page, current_value, current_value});
+    if (m_state_depth < m_state_stack.size()) {
+        m_state_stack[m_state_depth++] = {page, current_value, current_value};
+    }
 }
 
 void Menu::gotoParent(bool do_restore) {
-    const auto current_state = m_state_stack.top();
+    const auto current_state = m_state_stack[m_state_depth - 1];
 
     if (current_state.page == Page::Main) {
         m_active = false;
@@ -275,66 +318,69 @@ void Menu::gotoParent(bool do_restore) {
     if (do_restore) {
         switch (current_state.page) {
         case Page::DeviceMode:
-            m_store->setUsbMode(static_cast<usb_mode_t>(current_state.original_value));
+            m_store.setUsbMode(static_cast<usb_mode_t>(current_state.original_value));
+            break;
+        case Page::UsbPollInterval:
+            m_store.setUsbPollInterval(m_store.getUsbMode(), selectionToPollInterval(current_state.original_value));
             break;
         case Page::LedBrightness:
-            m_store->setLedBrightness(current_state.original_value);
+            m_store.setLedBrightness(current_state.original_value);
             break;
         case Page::LedAnimationSpeed:
-            m_store->setLedAnimationSpeed(current_state.original_value);
+            m_store.setLedAnimationSpeed(current_state.original_value);
             break;
         case Page::LedIdleMode:
-            m_store->setLedIdleMode(
+            m_store.setLedIdleMode(
                 static_cast<Peripherals::TouchSliderLeds::Config::IdleMode>(current_state.original_value));
             break;
         case Page::LedIdleColorRed: {
-            auto color = m_store->getLedIdleColor();
+            auto color = m_store.getLedIdleColor();
 
             color.r = current_state.original_value;
-            m_store->setLedIdleColor(color);
+            m_store.setLedIdleColor(color);
         } break;
         case Page::LedIdleColorGreen: {
-            auto color = m_store->getLedIdleColor();
+            auto color = m_store.getLedIdleColor();
 
             color.g = current_state.original_value;
-            m_store->setLedIdleColor(color);
+            m_store.setLedIdleColor(color);
         } break;
         case Page::LedIdleColorBlue: {
-            auto color = m_store->getLedIdleColor();
+            auto color = m_store.getLedIdleColor();
 
             color.b = current_state.original_value;
-            m_store->setLedIdleColor(color);
+            m_store.setLedIdleColor(color);
         } break;
         case Page::LedTouchedMode:
-            m_store->setLedTouchedMode(
+            m_store.setLedTouchedMode(
                 static_cast<Peripherals::TouchSliderLeds::Config::TouchedMode>(current_state.original_value));
             break;
         case Page::LedTouchedColorRed: {
-            auto color = m_store->getLedTouchedColor();
+            auto color = m_store.getLedTouchedColor();
 
             color.r = current_state.original_value;
-            m_store->setLedTouchedColor(color);
+            m_store.setLedTouchedColor(color);
         } break;
         case Page::LedTouchedColorGreen: {
-            auto color = m_store->getLedTouchedColor();
+            auto color = m_store.getLedTouchedColor();
 
             color.g = current_state.original_value;
-            m_store->setLedTouchedColor(color);
+            m_store.setLedTouchedColor(color);
         } break;
         case Page::LedTouchedColorBlue: {
-            auto color = m_store->getLedTouchedColor();
+            auto color = m_store.getLedTouchedColor();
 
             color.b = current_state.original_value;
-            m_store->setLedTouchedColor(color);
+            m_store.setLedTouchedColor(color);
         } break;
         case Page::LedEnablePlayerColor:
-            m_store->setLedEnablePlayerColor(static_cast<bool>(current_state.original_value));
+            m_store.setLedEnablePlayerColor(static_cast<bool>(current_state.original_value));
             break;
         case Page::LedEnablePdloaderSupport:
-            m_store->setLedEnablePdloaderSupport(static_cast<bool>(current_state.original_value));
+            m_store.setLedEnablePdloaderSupport(static_cast<bool>(current_state.original_value));
             break;
         case Page::InputMirrorToDpad:
-            m_store->setInputMirrorToDpad(static_cast<bool>(current_state.original_value));
+            m_store.setInputMirrorToDpad(static_cast<bool>(current_state.original_value));
             break;
         case Page::Main:
         case Page::Led:
@@ -347,7 +393,9 @@ void Menu::gotoParent(bool do_restore) {
         }
     }
 
-    m_state_stack.pop();
+    if (m_state_depth > 1) {
+        m_state_depth--;
+    }
 }
 
 void Menu::performAction(Descriptor::Action action, uint8_t value) {
@@ -360,6 +408,9 @@ void Menu::performAction(Descriptor::Action action, uint8_t value) {
     case Descriptor::Action::GotoPageDeviceMode:
         gotoPage(Page::DeviceMode);
         break;
+    case Descriptor::Action::GotoPageUsbPollInterval:
+        gotoPage(Page::UsbPollInterval);
+        break;
     case Descriptor::Action::GotoPageLed:
         gotoPage(Page::Led);
         break;
@@ -415,70 +466,73 @@ void Menu::performAction(Descriptor::Action action, uint8_t value) {
         gotoPage(Page::Bootsel);
         break;
     case Descriptor::Action::SetUsbMode:
-        m_store->setUsbMode(static_cast<usb_mode_t>(value));
+        m_store.setUsbMode(static_cast<usb_mode_t>(value));
+        break;
+    case Descriptor::Action::SetUsbPollInterval:
+        m_store.setUsbPollInterval(m_store.getUsbMode(), selectionToPollInterval(value));
         break;
     case Descriptor::Action::SetLedBrightness:
-        m_store->setLedBrightness(value);
+        m_store.setLedBrightness(value);
         break;
     case Descriptor::Action::SetLedAnimationSpeed:
-        m_store->setLedAnimationSpeed(value);
+        m_store.setLedAnimationSpeed(value);
         break;
     case Descriptor::Action::SetLedIdleMode:
-        m_store->setLedIdleMode(static_cast<Peripherals::TouchSliderLeds::Config::IdleMode>(value));
+        m_store.setLedIdleMode(static_cast<Peripherals::TouchSliderLeds::Config::IdleMode>(value));
         break;
     case Descriptor::Action::SetLedIdleColorRed: {
-        auto color = m_store->getLedIdleColor();
+        auto color = m_store.getLedIdleColor();
 
         color.r = value;
-        m_store->setLedIdleColor(color);
+        m_store.setLedIdleColor(color);
     } break;
     case Descriptor::Action::SetLedIdleColorGreen: {
-        auto color = m_store->getLedIdleColor();
+        auto color = m_store.getLedIdleColor();
 
         color.g = value;
-        m_store->setLedIdleColor(color);
+        m_store.setLedIdleColor(color);
     } break;
     case Descriptor::Action::SetLedIdleColorBlue: {
-        auto color = m_store->getLedIdleColor();
+        auto color = m_store.getLedIdleColor();
 
         color.b = value;
-        m_store->setLedIdleColor(color);
+        m_store.setLedIdleColor(color);
     } break;
     case Descriptor::Action::SetLedTouchedMode:
-        m_store->setLedTouchedMode(static_cast<Peripherals::TouchSliderLeds::Config::TouchedMode>(value));
+        m_store.setLedTouchedMode(static_cast<Peripherals::TouchSliderLeds::Config::TouchedMode>(value));
         break;
     case Descriptor::Action::SetLedTouchedColorRed: {
-        auto color = m_store->getLedTouchedColor();
+        auto color = m_store.getLedTouchedColor();
 
         color.r = value;
-        m_store->setLedTouchedColor(color);
+        m_store.setLedTouchedColor(color);
     } break;
     case Descriptor::Action::SetLedTouchedColorGreen: {
-        auto color = m_store->getLedTouchedColor();
+        auto color = m_store.getLedTouchedColor();
 
         color.g = value;
-        m_store->setLedTouchedColor(color);
+        m_store.setLedTouchedColor(color);
     } break;
     case Descriptor::Action::SetLedTouchedColorBlue: {
-        auto color = m_store->getLedTouchedColor();
+        auto color = m_store.getLedTouchedColor();
 
         color.b = value;
-        m_store->setLedTouchedColor(color);
+        m_store.setLedTouchedColor(color);
     } break;
     case Descriptor::Action::SetLedEnablePlayerColor:
-        m_store->setLedEnablePlayerColor(static_cast<bool>(value));
+        m_store.setLedEnablePlayerColor(static_cast<bool>(value));
         break;
     case Descriptor::Action::SetLedEnablePdloaderSupport:
-        m_store->setLedEnablePdloaderSupport(static_cast<bool>(value));
+        m_store.setLedEnablePdloaderSupport(static_cast<bool>(value));
         break;
     case Descriptor::Action::SetInputMirrorToDpad:
-        m_store->setInputMirrorToDpad(static_cast<bool>(value));
+        m_store.setInputMirrorToDpad(static_cast<bool>(value));
         break;
     case Descriptor::Action::DoReset:
-        m_store->reset();
+        m_store.reset();
         break;
     case Descriptor::Action::DoRebootToBootsel:
-        m_store->scheduleReboot(true);
+        m_store.scheduleReboot(true);
         gotoPage(Page::BootselMsg);
         break;
     }
@@ -488,40 +542,40 @@ void Menu::performAction(Descriptor::Action action, uint8_t value) {
 
 void Menu::update(const InputState &input_state) {
     InputState::Buttons pressed = checkPressed(input_state);
-    State &current_state = m_state_stack.top();
+    State &current_state = m_state_stack[m_state_depth - 1];
 
-    auto descriptor_it = descriptors.find(current_state.page);
-    if (descriptor_it == descriptors.end()) {
+    const auto descriptor = findDescriptor(current_state.page);
+    if (descriptor == nullptr) {
         assert(false);
         return;
     }
 
-    if (descriptor_it->second.type == Descriptor::Type::RebootInfo) {
+    if (descriptor->type == Descriptor::Type::RebootInfo) {
         m_active = false;
     } else if (pressed.north) { // Previous
-        switch (descriptor_it->second.type) {
+        switch (descriptor->type) {
         case Descriptor::Type::Value:
             if (current_state.selected_value > 0) {
                 current_state.selected_value--;
-                performAction(descriptor_it->second.items.at(0).second, current_state.selected_value);
+                performAction(descriptor->items[0].action, current_state.selected_value);
             }
             break;
         case Descriptor::Type::Toggle:
             current_state.selected_value = !current_state.selected_value;
-            performAction(descriptor_it->second.items.at(0).second, current_state.selected_value);
+            performAction(descriptor->items[0].action, current_state.selected_value);
             break;
         case Descriptor::Type::Selection:
             if (current_state.selected_value == 0) {
-                current_state.selected_value = descriptor_it->second.items.size() - 1;
+                current_state.selected_value = descriptor->items.size() - 1;
             } else {
                 current_state.selected_value--;
             }
-            performAction(descriptor_it->second.items.at(current_state.selected_value).second,
+            performAction(descriptor->items[current_state.selected_value].action,
                           current_state.selected_value);
             break;
         case Descriptor::Type::Menu:
             if (current_state.selected_value == 0) {
-                current_state.selected_value = descriptor_it->second.items.size() - 1;
+                current_state.selected_value = descriptor->items.size() - 1;
             } else {
                 current_state.selected_value--;
             }
@@ -530,28 +584,28 @@ void Menu::update(const InputState &input_state) {
             break;
         }
     } else if (pressed.west) { // Next
-        switch (descriptor_it->second.type) {
+        switch (descriptor->type) {
         case Descriptor::Type::Value:
             if (current_state.selected_value < UINT8_MAX) {
                 current_state.selected_value++;
-                performAction(descriptor_it->second.items.at(0).second, current_state.selected_value);
+                performAction(descriptor->items[0].action, current_state.selected_value);
             }
             break;
         case Descriptor::Type::Toggle:
             current_state.selected_value = !current_state.selected_value;
-            performAction(descriptor_it->second.items.at(0).second, current_state.selected_value);
+            performAction(descriptor->items[0].action, current_state.selected_value);
             break;
         case Descriptor::Type::Selection:
-            if (current_state.selected_value == descriptor_it->second.items.size() - 1) {
+            if (current_state.selected_value == descriptor->items.size() - 1) {
                 current_state.selected_value = 0;
             } else {
                 current_state.selected_value++;
             }
-            performAction(descriptor_it->second.items.at(current_state.selected_value).second,
+            performAction(descriptor->items[current_state.selected_value].action,
                           current_state.selected_value);
             break;
         case Descriptor::Type::Menu:
-            if (current_state.selected_value == descriptor_it->second.items.size() - 1) {
+            if (current_state.selected_value == descriptor->items.size() - 1) {
                 current_state.selected_value = 0;
             } else {
                 current_state.selected_value++;
@@ -561,7 +615,7 @@ void Menu::update(const InputState &input_state) {
             break;
         }
     } else if (pressed.south) { // Back/Exit
-        switch (descriptor_it->second.type) {
+        switch (descriptor->type) {
         case Descriptor::Type::Value:
         case Descriptor::Type::Toggle:
         case Descriptor::Type::Selection:
@@ -574,14 +628,14 @@ void Menu::update(const InputState &input_state) {
             break;
         }
     } else if (pressed.east) { // Select
-        switch (descriptor_it->second.type) {
+        switch (descriptor->type) {
         case Descriptor::Type::Value:
         case Descriptor::Type::Toggle:
         case Descriptor::Type::Selection:
             gotoParent(false);
             break;
         case Descriptor::Type::Menu:
-            performAction(descriptor_it->second.items.at(current_state.selected_value).second,
+            performAction(descriptor->items[current_state.selected_value].action,
                           current_state.selected_value);
             break;
         case Descriptor::Type::RebootInfo:
@@ -592,6 +646,6 @@ void Menu::update(const InputState &input_state) {
 
 bool Menu::active() { return m_active; }
 
-Menu::State Menu::getState() { return m_state_stack.top(); }
+Menu::State Menu::getState() { return m_state_stack[m_state_depth - 1]; }
 
 } // namespace Divacon::Utils
@@ -0,0 +1,337 @@
+#include "utils/ModExp.h"
+
+#include <algorithm>
+
+namespace Divacon::Utils {
+
+ModExp::ModExp()
+    : m_limbs(0), m_rows_per_step(0), m_modulus({}), m_modulus_inv(0), m_rr({}), m_base_low({}), m_base_high({}),
+      m_exponent({}), m_window_count(0), m_multiply_only(false), m_table({}), m_operand({}), m_acc({}),
+      m_phase(Phase::Idle), m_index(0), m_mul({}) {}
+
+void ModExp::fromBytes(Limbs &limbs, size_t limb_count, const uint8_t *bytes, size_t length) {
+    limbs.fill(0);
+
+    for (size_t idx = 0; idx < length && idx / 4 < limb_count; ++idx) {
+        limbs[idx / 4] |= static_cast<uint32_t>(bytes[length - 1 - idx]) << ((idx % 4) * 8);
+    }
+}
+
+// Subtracts the modulus if high * R + value isn't below it, which needs to be below twice the
+// modulus. Both passes always run, only the subtrahend is masked.
+void ModExp::reduceOnce(uint32_t *value, uint32_t high) const {
+    uint32_t borrow = 0;
+    for (size_t idx = 0; idx < m_limbs; ++idx) {
+        const uint64_t diff = static_cast<uint64_t>(value[idx]) - m_modulus[idx] - borrow;
+        borrow = static_cast<uint32_t>(diff >> 32) & 1;
+    }
+
+    const uint32_t mask = (borrow & ~high & 1) - 1;
+
+    borrow = 0;
+    for (size_t idx = 0; idx < m_limbs; ++idx) {
+        const uint64_t diff = static_cast<uint64_t>(value[idx]) - (m_modulus[idx] & mask) - borrow;
+        value[idx] = static_cast<uint32_t>(diff);
+        borrow = static_cast<uint32_t>(diff >> 32) & 1;
+    }
+}
+
+// Starts computing a * b / R mod modulus, requires a * b < modulus * R. `out` may alias the
+// inputs, it is only written once the multiplication is complete.
+void ModExp::startMul(Limbs &out, const Limbs &a, const Limbs &b) {
+    m_mul.active = true;
+    m_mul.row = 0;
+    m_mul.out = &out;
+    m_mul.a = &a;
+    m_mul.b = &b;
+    m_mul.product.fill(0);
+
+    continueMul();
+}
+
+void ModExp::continueMul() {
+    auto &t = m_mul.product;
+    const auto &a = *m_mul.a;
+    const auto &b = *m_mul.b;
+    const size_t n = m_limbs;
+
+    for (const size_t end = std::min(m_mul.row + m_rows_per_step, n); m_mul.row < end; ++m_mul.row) {
+        const size_t i = m_mul.row;
+
+        uint64_t carry = 0;
+        for (size_t j = 0; j < n; ++j) {
+            const uint64_t sum = static_cast<uint64_t>(a[j]) * b[i] + t[j] + carry;
+            t[j] = static_cast<uint32_t>(sum);
+            carry = sum >> 32;
+        }
+        uint64_t sum = static_cast<uint64_t>(t[n]) + carry;
+        t[n] = static_cast<uint32_t>(sum);
+        t[n + 1] = static_cast<uint32_t>(sum >> 32);
+
+        const uint32_t m = t[0] * m_modulus_inv;
+        carry = (static_cast<uint64_t>(m) * m_modulus[0] + t[0]) >> 32;
+        for (size_t j = 1; j < n; ++j) {
+            sum = static_cast<uint64_t>(m) * m_modulus[j] + t[j] + carry;
+            t[j - 1] = static_cast<uint32_t>(sum);
+            carry = sum >> 32;
+        }
+        sum = static_cast<uint64_t>(t[n]) + carry;
+        t[n - 1] = static_cast<uint32_t>(sum);
+        t[n] = t[n + 1] + static_cast<uint32_t>(sum >> 32);
+    }
+
+    if (m_mul.row < n) {
+        return;
+    }
+
+    // t < 2 * modulus here
+    reduceOnce(t.data(), t[n]);
+    std::copy_n(t.begin(), n, m_mul.out->begin());
+
+    m_mul.active = false;
+}
+
+uint8_t ModExp::getWindow(size_t window) const {
+    const size_t bit = window * WINDOW_BITS;
+    return (m_exponent[bit / 32] >> (bit % 32)) & ((1 << WINDOW_BITS) - 1);
+}
+
+// Reads every table entry and keeps the wanted one by mask, so the memory access pattern doesn't
+// depend on the exponent.
+void ModExp::select(Limbs &out, uint8_t index) const {
+    out.fill(0);
+
+    for (size_t entry = 0; entry < m_table.size(); ++entry) {
+        const uint32_t diff = static_cast<uint32_t>(entry) ^ index;
+        const uint32_t mask = ((diff | (0u - diff)) >> 31) - 1;
+
+        for (size_t idx = 0; idx < m_limbs; ++idx) {
+            out[idx] |= m_table[entry][idx] & mask;
+        }
+    }
+}
+
+bool ModExp::setup(const uint8_t *base, size_t base_length, const uint8_t *modulus, size_t modulus_length) {
+    // Leading zeros of the modulus don't count towards its length.
+    while (modulus_length > 0 && *modulus == 0) {
+        ++modulus;
+        --modulus_length;
+    }
+
+    m_limbs = (modulus_length + 3) / 4;
+    if (m_limbs == 0 || m_limbs > MAX_LIMBS || (modulus[modulus_length - 1] & 1) == 0 ||
+        base_length > m_limbs * 8) {
+        return false;
+    }
+
+    m_rows_per_step = std::max<size_t>(1, MULS_PER_STEP / (2 * m_limbs));
+
+    fromBytes(m_modulus, m_limbs, modulus, modulus_length);
+
+    // Newton iteration, every round doubles the number of correct low bits.
+    uint32_t inv = 1;
+    for (size_t round = 0; round < 5; ++round) {
+        inv *= 2 - m_modulus[0] * inv;
+    }
+    m_modulus_inv = -inv;
+
+    const size_t low_length = std::min(base_length, m_limbs * 4);
+    fromBytes(m_base_low, m_limbs, base + (base_length - low_length), low_length);
+    fromBytes(m_base_high, m_limbs, base, base_length - low_length);
+
+    m_rr = {};
+    m_rr[0] = 1;
+
+    m_index = 0;
+
+    return true;
+}
+
+bool ModExp::begin(const uint8_t *base, size_t base_length, const uint8_t *exponent, size_t exponent_length,
+                   const uint8_t *modulus, size_t modulus_length) {
+    m_phase = Phase::Idle;
+    m_mul.active = false;
+
+    if (!setup(base, base_length, modulus, modulus_length)) {
+        return false;
+    }
+
+    // Bytes beyond the modulus length need to be zero, they are all read either way.
+    uint8_t excess = 0;
+    for (; exponent_length > m_limbs * 4; ++exponent, --exponent_length) {
+        excess |= *exponent;
+    }
+    if (excess != 0) {
+        return false;
+    }
+
+    // As many windows as the modulus has, so neither the value nor the bit length of the exponent shows in the time.
+    fromBytes(m_exponent, MAX_LIMBS, exponent, exponent_length);
+    m_window_count = m_limbs * 32 / WINDOW_BITS;
+
+    m_multiply_only = false;
+    m_phase = Phase::Setup;
+
+    return true;
+}
+
+bool ModExp::beginPublic(const uint8_t *base, size_t base_length, const uint8_t *exponent, size_t exponent_length,
+                         const uint8_t *modulus, size_t modulus_length) {
+    m_phase = Phase::Idle;
+    m_mul.active = false;
+
+    while (exponent_length > 0 && *exponent == 0) {
+        ++exponent;
+        --exponent_length;
+    }
+
+    if (exponent_length > MAX_LIMBS * 4 || !setup(base, base_length, modulus, modulus_length)) {
+        return false;
+    }
+
+    // Leading zero windows are skipped, which makes short exponents like 65537 cheap.
+    fromBytes(m_exponent, MAX_LIMBS, exponent, exponent_length);
+    m_window_count = (exponent_length * 8 + WINDOW_BITS - 1) / WINDOW_BITS;
+    while (m_window_count > 0 && getWindow(m_window_count - 1) == 0) {
+        --m_window_count;
+    }
+
+    m_multiply_only = false;
+    m_phase = Phase::Setup;
+
+    return true;
+}
+
+bool ModExp::beginMultiply(const uint8_t *a, size_t a_length, const uint8_t *b, size_t b_length,
+                           const uint8_t *modulus, size_t modulus_length) {
+    m_phase = Phase::Idle;
+    m_mul.active = false;
+
+    if (!setup(a, a_length, modulus, modulus_length) || b_length > m_limbs * 4) {
+        return false;
+    }
+
+    fromBytes(m_operand, m_limbs, b, b_length);
+
+    m_multiply_only = true;
+    m_phase = Phase::Setup;
+
+    return true;
+}
+
+bool ModExp::step() {
+    if (m_mul.active) {
+        continueMul();
+        return done();
+    }
+
+    switch (m_phase) {
+    case Phase::Idle:
+    case Phase::Done:
+        break;
+    case Phase::Setup:
+        // Double 1 up to R^2 mod modulus.
+        for (size_t count = 0; count < RR_DOUBLINGS_PER_STEP && m_index < m_limbs * 64; ++count, ++m_index) {
+            uint32_t carry = 0;
+            for (size_t idx = 0; idx < m_limbs; ++idx) {
+                const uint32_t next_carry = m_rr[idx] >> 31;
+                m_rr[idx] = (m_rr[idx] << 1) | carry;
+                carry = next_carry;
+            }
+            reduceOnce(m_rr.data(), carry);
+        }
+        if (m_index == m_limbs * 64) {
+            m_phase = Phase::Reduce;
+            m_index = 0;
+        }
+        break;
+    case Phase::Reduce: {
+        // base * R = base_low * R + base_high * R * R
+        switch (m_index++) {
+        case 0:
+            startMul(m_table[1], m_base_low, m_rr);
+            break;
+        case 1:
+            startMul(m_acc, m_base_high, m_rr);
+            break;
+        case 2:
+            startMul(m_acc, m_acc, m_rr);
+            break;
+        case 3: {
+            uint32_t carry = 0;
+            for (size_t idx = 0; idx < m_limbs; ++idx) {
+                const uint64_t sum = static_cast<uint64_t>(m_table[1][idx]) + m_acc[idx] + carry;
+                m_table[1][idx] = static_cast<uint32_t>(sum);
+                carry = sum >> 32;
+            }
+            reduceOnce(m_table[1].data(), carry);
+
+            if (m_multiply_only) {
+                // a * R * b / R
+                startMul(m_acc, m_table[1], m_operand);
+                m_phase = Phase::Done;
+                break;
+            }
+
+            // R mod modulus, which is 1 in Montgomery form.
+            m_operand = {};
+            m_operand[0] = 1;
+            startMul(m_table[0], m_rr, m_operand);
+
+            m_phase = Phase::Table;
+            m_index = 2;
+        } break;
+        }
+    } break;
+    case Phase::Table:
+        startMul(m_table[m_index], m_table[m_index - 1], m_table[1]);
+        if (++m_index == m_table.size()) {
+            m_phase = Phase::Exponent;
+            m_index = 0;
+        }
+        break;
+    case Phase::Exponent:
+        if (m_window_count == 0) {
+            m_acc = m_table[0];
+            m_phase = Phase::Finish;
+            break;
+        }
+
+        // Every window takes WINDOW_BITS squarings followed by one multiplication.
+        if (m_index == 0) {
+            select(m_acc, getWindow(m_window_count - 1));
+            m_index = (WINDOW_BITS + 1);
+        } else if (m_index % (WINDOW_BITS + 1) != WINDOW_BITS) {
+            startMul(m_acc, m_acc, m_acc);
+            ++m_index;
+        } else {
+            const size_t window = m_window_count - 1 - m_index / (WINDOW_BITS + 1);
+            select(m_operand, getWindow(window));
+            startMul(m_acc, m_acc, m_operand);
+            ++m_index;
+        }
+
+        if (m_index == m_window_count * (WINDOW_BITS + 1)) {
+            m_phase = Phase::Finish;
+        }
+        break;
+    case Phase::Finish:
+        m_operand = {};
+        m_operand[0] = 1;
+        startMul(m_acc, m_acc, m_operand);
+
+        m_phase = Phase::Done;
+        break;
+    }
+
+    return done();
+}
+
+void ModExp::getResult(uint8_t *out, size_t length) const {
+    for (size_t idx = 0; idx < length; ++idx) {
+        const size_t byte = length - 1 - idx;
+        out[idx] = (byte / 4 < m_limbs) ? static_cast<uint8_t>(m_acc[byte / 4] >> ((byte % 4) * 8)) : 0;
+    }
+}
+
+} // namespace Divacon::Utils
@@ -2,73 +2,278 @@
 
 #include "PS4AuthConfiguration.h"
 
+#include "mbedtls/bignum.h"
 #include "mbedtls/rsa.h"
 #include "mbedtls/sha256.h"
 #include "pico/rand.h"
+#include "pico/time.h"
 
-#include "usb/device_driver.h"
+#include <algorithm>
+#include <cstring>
 
 namespace {
+
 int rng(void *p_rng, unsigned char *p, size_t len) {
     (void)p_rng;
 
     uint64_t rand = 0;
-    size_t rand_byte = get_rand_64();
-
     for (size_t idx = 0; idx < len; ++idx) {
-        if (rand_byte >= sizeof(uint64_t)) {
+        if (idx % sizeof(rand) == 0) {
             rand = get_rand_64();
-            rand_byte = 0;
         }
-        p[idx] = rand >> (++rand_byte * 8);
+        p[idx] = static_cast<uint8_t>(rand >> ((idx % sizeof(rand)) * 8));
     }
 
     return 0;
 }
+
+// Big endian addition and subtraction over a whole buffer, `value` is right aligned to it. The
+// loops only depend on the lengths, the carries are never branched on.
+template <size_t N> void add(std::array<uint8_t, N> &out, const uint8_t *value, size_t length) {
+    uint32_t carry = 0;
+    for (size_t idx = 0; idx < N; ++idx) {
+        carry += out[N - 1 - idx] + (idx < length ? value[length - 1 - idx] : 0);
+        out[N - 1 - idx] = static_cast<uint8_t>(carry);
+        carry >>= 8;
+    }
+}
+
+template <size_t N> void subtract(std::array<uint8_t, N> &out, const uint8_t *value, size_t length) {
+    uint32_t borrow = 0;
+    for (size_t idx = 0; idx < N; ++idx) {
+        const uint32_t diff = out[N - 1 - idx] - (idx < length ? value[length - 1 - idx] : 0) - borrow;
+        out[N - 1 - idx] = static_cast<uint8_t>(diff);
+        borrow = (diff >> 8) & 1;
+    }
+}
+
 } // namespace
 
 namespace Divacon::Utils {
 
-PS4AuthProvider::PS4AuthProvider() : m_key_valid(false) {
+PS4AuthProvider::PS4AuthProvider()
+    : m_key_valid(false), m_modulus_bits(0), m_phase(Phase::Idle), m_signature_valid(false) {
     if (!Divacon::Config::PS4Auth::config.enabled) {
         return;
     }
 
     mbedtls_pk_init(&m_pk_context);
 
-    if (mbedtls_pk_parse_key(&m_pk_context, (unsigned char *)Divacon::Config::PS4Auth::config.key_pem.c_str(),
-                             Divacon::Config::PS4Auth::config.key_pem.size() + 1, nullptr, 0)) {
+    const char *key_pem = Divacon::Config::PS4Auth::config.key_pem;
+    if (mbedtls_pk_parse_key(&m_pk_context, (const unsigned char *)key_pem, strlen(key_pem) + 1, nullptr, 0)) {
         return;
     }
 
-    mbedtls_rsa_set_padding(mbedtls_pk_rsa(m_pk_context), MBEDTLS_RSA_PKCS_V21, MBEDTLS_MD_SHA256);
-
-    m_key_valid = true;
+    m_key_valid = exportKey();
 }
 
 PS4AuthProvider::~PS4AuthProvider() { mbedtls_pk_free(&m_pk_context); }
 
-std::optional<std::array<uint8_t, PS4AuthProvider::SIGNATURE_LENGTH>>
-PS4AuthProvider::sign(const std::array<uint8_t, PS4AuthProvider::SIGNATURE_LENGTH> &challenge) {
-    if (!m_key_valid) {
-        return std::nullopt;
+// The private key operation is done on our own, so it can be split into steps.
+bool PS4AuthProvider::exportKey() {
+    const auto rsa_context = mbedtls_pk_rsa(m_pk_context);
+
+    mbedtls_mpi n, e, p, q, dp, dq, qp, p_multiple;
+    for (auto mpi : {&n, &e, &p, &q, &dp, &dq, &qp, &p_multiple}) {
+        mbedtls_mpi_init(mpi);
     }
 
-    std::array<uint8_t, 32> hashed_challenge = {};
-    auto signed_challenge = std::array<uint8_t, PS4AuthProvider::SIGNATURE_LENGTH>();
+    const auto write = [](KeyPart &part, const mbedtls_mpi &mpi) {
+        part.length = mbedtls_mpi_size(&mpi);
+        return part.length <= part.data.size() && !mbedtls_mpi_write_binary(&mpi, part.data.data(), part.length);
+    };
+    // Secret exponents are left padded to the length of their modulus.
+    const auto write_padded = [](KeyPart &part, const mbedtls_mpi &mpi, const KeyPart &modulus) {
+        part.length = modulus.length;
+        return part.length <= part.data.size() && !mbedtls_mpi_write_binary(&mpi, part.data.data(), part.length);
+    };
 
-    const auto rsa_context = mbedtls_pk_rsa(m_pk_context);
+    // A multiple of p above q, so m1 - m2 can be made positive without comparing them.
+    const auto multiply_p = [&]() {
+        const size_t p_bits = mbedtls_mpi_bitlen(&p);
+        const size_t q_bits = mbedtls_mpi_bitlen(&q);
+        return !mbedtls_mpi_copy(&p_multiple, &p) &&
+               !mbedtls_mpi_shift_l(&p_multiple, (q_bits > p_bits ? q_bits - p_bits : 0) + 1);
+    };
+
+    const bool success = !mbedtls_rsa_export(rsa_context, &n, &p, &q, nullptr, &e) &&
+                         !mbedtls_rsa_export_crt(rsa_context, &dp, &dq, &qp) && multiply_p() && write(m_n, n) &&
+                         write(m_e, e) && write(m_p, p) && write(m_q, q) && write_padded(m_dp, dp, m_p) &&
+                         write_padded(m_dq, dq, m_q) && write(m_qp, qp) && write(m_p_multiple, p_multiple);
+
+    m_modulus_bits = mbedtls_mpi_bitlen(&n);
 
+    for (auto mpi : {&n, &e, &p, &q, &dp, &dq, &qp, &p_multiple}) {
+        mbedtls_mpi_free(mpi);
+    }
+
+    return success && m_n.length == SIGNATURE_LENGTH;
+}
+
+// EMSA-PSS encoding with SHA-256 and a salt as long as the hash, the same way
+// mbedtls_rsa_rsassa_pss_sign() does it.
+bool PS4AuthProvider::encode(const Signature &challenge) {
+    std::array<uint8_t, HASH_LENGTH> hashed_challenge = {};
     if (mbedtls_sha256_ret(challenge.data(), challenge.size(), hashed_challenge.data(), 0)) {
-        return std::nullopt;
+        return false;
+    }
+
+    m_encoded.fill(0);
+
+    uint8_t *salt = m_encoded.data() + SIGNATURE_LENGTH - HASH_LENGTH - SALT_LENGTH - 1;
+    uint8_t *hash = m_encoded.data() + SIGNATURE_LENGTH - HASH_LENGTH - 1;
+
+    *(salt - 1) = 0x01;
+    rng(nullptr, salt, SALT_LENGTH);
+
+    // H = Hash(8 zero bytes || mHash || salt)
+    const std::array<uint8_t, 8> zeros = {};
+    mbedtls_sha256_context sha256_context;
+    mbedtls_sha256_init(&sha256_context);
+
+    bool success = !mbedtls_sha256_starts_ret(&sha256_context, 0) &&
+                   !mbedtls_sha256_update_ret(&sha256_context, zeros.data(), zeros.size()) &&
+                   !mbedtls_sha256_update_ret(&sha256_context, hashed_challenge.data(), hashed_challenge.size()) &&
+                   !mbedtls_sha256_update_ret(&sha256_context, salt, SALT_LENGTH) &&
+                   !mbedtls_sha256_finish_ret(&sha256_context, hash);
+
+    // Mask DB with MGF1(H), encoding is over the length of the modulus - 1 bits.
+    const size_t msb = m_modulus_bits - 1;
+    const size_t offset = (msb % 8 == 0) ? 1 : 0;
+    const size_t db_length = SIGNATURE_LENGTH - HASH_LENGTH - 1 - offset;
+
+    std::array<uint8_t, HASH_LENGTH> mask;
+    for (uint32_t counter = 0; success && counter * HASH_LENGTH < db_length; ++counter) {
+        const std::array<uint8_t, 4> counter_bytes = {
+            static_cast<uint8_t>(counter >> 24),
+            static_cast<uint8_t>(counter >> 16),
+            static_cast<uint8_t>(counter >> 8),
+            static_cast<uint8_t>(counter),
+        };
+
+        success = !mbedtls_sha256_starts_ret(&sha256_context, 0) &&
+                  !mbedtls_sha256_update_ret(&sha256_context, hash, HASH_LENGTH) &&
+                  !mbedtls_sha256_update_ret(&sha256_context, counter_bytes.data(), counter_bytes.size()) &&
+                  !mbedtls_sha256_finish_ret(&sha256_context, mask.data());
+
+        for (size_t idx = 0; idx < HASH_LENGTH && counter * HASH_LENGTH + idx < db_length; ++idx) {
+            m_encoded[offset + counter * HASH_LENGTH + idx] ^= mask[idx];
+        }
     }
 
-    if (mbedtls_rsa_rsassa_pss_sign(rsa_context, rng, nullptr, MBEDTLS_RSA_PRIVATE, MBEDTLS_MD_SHA256,
-                                    hashed_challenge.size(), hashed_challenge.data(), signed_challenge.data())) {
+    mbedtls_sha256_free(&sha256_context);
+
+    m_encoded[0] &= 0xFF >> (SIGNATURE_LENGTH * 8 - msb);
+    m_encoded[SIGNATURE_LENGTH - 1] = 0xBC;
+
+    return success;
+}
+
+void PS4AuthProvider::advance() {
+    switch (m_phase) {
+    case Phase::Idle:
+    case Phase::Done:
+        break;
+    case Phase::ExpP:
+        if (m_exp.step()) {
+            m_m1.length = m_p.length;
+            m_exp.getResult(m_m1.data.data(), m_m1.length);
+
+            m_phase = m_exp.begin(m_encoded.data(), m_encoded.size(), m_dq.data.data(), m_dq.length, m_q.data.data(),
+                                  m_q.length)
+                          ? Phase::ExpQ
+                          : Phase::Done;
+        }
+        break;
+    case Phase::ExpQ:
+        if (m_exp.step()) {
+            m_m2.length = m_q.length;
+            m_exp.getResult(m_m2.data.data(), m_m2.length);
+
+            // CRT recombination: s = m2 + q * (qp * (m1 - m2) mod p), with both multiplications
+            // done by m_exp so they are split into steps as well.
+            Signature difference = {};
+            add(difference, m_m1.data.data(), m_m1.length);
+            add(difference, m_p_multiple.data.data(), m_p_multiple.length);
+            subtract(difference, m_m2.data.data(), m_m2.length);
+
+            m_phase = m_exp.beginMultiply(difference.data(), difference.size(), m_qp.data.data(), m_qp.length,
+                                          m_p.data.data(), m_p.length)
+                          ? Phase::CombineP
+                          : Phase::Done;
+        }
+        break;
+    case Phase::CombineP:
+        if (m_exp.step()) {
+            KeyPart h;
+            h.length = m_p.length;
+            m_exp.getResult(h.data.data(), h.length);
+
+            // q * h is below n, so the reduction leaves it unchanged.
+            m_phase = m_exp.beginMultiply(m_q.data.data(), m_q.length, h.data.data(), h.length, m_n.data.data(),
+                                          m_n.length)
+                          ? Phase::CombineN
+                          : Phase::Done;
+        }
+        break;
+    case Phase::CombineN:
+        if (m_exp.step()) {
+            m_exp.getResult(m_signature.data(), m_signature.size());
+            add(m_signature, m_m2.data.data(), m_m2.length);
+
+            // Check the result with the public key like mbedtls does, guarding against faults.
+            m_phase = m_exp.beginPublic(m_signature.data(), m_signature.size(), m_e.data.data(), m_e.length,
+                                        m_n.data.data(), m_n.length)
+                          ? Phase::Verify
+                          : Phase::Done;
+        }
+        break;
+    case Phase::Verify:
+        if (m_exp.step()) {
+            Signature verified;
+            m_exp.getResult(verified.data(), verified.size());
+
+            m_signature_valid = (verified == m_encoded);
+            m_phase = Phase::Done;
+        }
+        break;
+    }
+}
+
+bool PS4AuthProvider::begin(const Signature &challenge) {
+    m_phase = Phase::Idle;
+    m_signature_valid = false;
+
+    if (!m_key_valid || !encode(challenge) ||
+        !m_exp.begin(m_encoded.data(), m_encoded.size(), m_dp.data.data(), m_dp.length, m_p.data.data(),
+                     m_p.length)) {
+        return false;
+    }
+
+    m_phase = Phase::ExpP;
+    return true;
+}
+
+bool PS4AuthProvider::step(uint32_t budget_us) {
+    const uint32_t start = time_us_32();
+
+    while (m_phase != Phase::Idle && m_phase != Phase::Done) {
+        advance();
+
+        if (time_us_32() - start >= budget_us) {
+            break;
+        }
+    }
+
+    return m_phase == Phase::Done;
+}
+
+std::optional<PS4AuthProvider::Signature> PS4AuthProvider::getSignature() const {
+    if (m_phase != Phase::Done || !m_signature_valid) {
         return std::nullopt;
     }
 
-    return signed_challenge;
+    return m_signature;
 }
 
-} // namespace Divacon::Utils
\ No newline at end of file
+} // namespace Divacon::Utils
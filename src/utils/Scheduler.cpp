@@ -0,0 +1,141 @@
+#include "utils/Scheduler.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Divacon::Utils {
+
+namespace {
+
+// Whether `a` is before `b`, tolerating wrap around of the clock.
+bool isBefore(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) < 0; }
+
+} // namespace
+
+Scheduler::Scheduler(Clock clock) : m_clock(clock), m_tasks({}), m_task_count(0) {}
+
+Scheduler::TaskId Scheduler::addTask(const TaskConfig &config, TaskFunction function) {
+    if (m_task_count >= MAX_TASKS) {
+        return INVALID_TASK;
+    }
+
+    const TaskId id = m_task_count++;
+    auto &task = m_tasks[id];
+
+    task.config = config;
+    task.function = function;
+    task.released = false;
+    task.release_us = 0;
+    task.next_release_us = m_clock();
+    task.deadline_us = 0;
+    task.stats = {config.name, 0, 0, 0, 0, 0};
+
+    return id;
+}
+
+void Scheduler::trigger(TaskId id) {
+    if (id >= m_task_count) {
+        return;
+    }
+
+    auto &task = m_tasks[id];
+
+    if (!task.released) {
+        task.released = true;
+        task.release_us = m_clock();
+        task.deadline_us = task.release_us + task.config.deadline_us;
+    }
+}
+
+void Scheduler::release(uint32_t now_us) {
+    for (size_t id = 0; id < m_task_count; ++id) {
+        auto &task = m_tasks[id];
+
+        if (task.config.period_us == 0 || isBefore(now_us, task.next_release_us)) {
+            continue;
+        }
+
+        if (!task.released) {
+            task.released = true;
+            task.release_us = task.next_release_us;
+            task.deadline_us = task.release_us + task.config.deadline_us;
+        }
+        task.next_release_us += task.config.period_us;
+
+        // Don't burst to catch up, skipped periods are accounted as misses.
+        if (!isBefore(now_us, task.next_release_us)) {
+            const uint32_t skipped = (now_us - task.next_release_us) / task.config.period_us + 1;
+
+            task.next_release_us += skipped * task.config.period_us;
+            task.stats.misses += skipped;
+        }
+    }
+}
+
+bool Scheduler::runNext() {
+    release(m_clock());
+
+    Task *next = nullptr;
+    for (size_t id = 0; id < m_task_count; ++id) {
+        auto &task = m_tasks[id];
+
+        if (!task.released) {
+            continue;
+        }
+
+        if (next == nullptr || isBefore(task.deadline_us, next->deadline_us) ||
+            (task.deadline_us == next->deadline_us && task.config.priority > next->config.priority)) {
+            next = &task;
+        }
+    }
+
+    if (next == nullptr) {
+        return false;
+    }
+
+    // Cleared before running so the task can trigger itself again.
+    next->released = false;
+
+    const uint32_t start_us = m_clock();
+    next->function(start_us);
+    const uint32_t end_us = m_clock();
+
+    const uint32_t runtime_us = end_us - start_us;
+
+    next->stats.runs++;
+    next->stats.max_latency_us = std::max(next->stats.max_latency_us, start_us - next->release_us);
+    next->stats.max_runtime_us = std::max(next->stats.max_runtime_us, runtime_us);
+    next->stats.total_runtime_us += runtime_us;
+    if (isBefore(next->deadline_us, end_us)) {
+        next->stats.misses++;
+    }
+
+    return true;
+}
+
+uint32_t Scheduler::getIdleTime() {
+    const uint32_t now_us = m_clock();
+    release(now_us);
+
+    uint32_t idle_us = std::numeric_limits<uint32_t>::max();
+    for (size_t id = 0; id < m_task_count; ++id) {
+        const auto &task = m_tasks[id];
+
+        if (task.released) {
+            return 0;
+        }
+        if (task.config.period_us != 0) {
+            idle_us = std::min(idle_us, task.next_release_us - now_us);
+        }
+    }
+
+    return idle_us;
+}
+
+void Scheduler::resetStats() {
+    for (size_t id = 0; id < m_task_count; ++id) {
+        m_tasks[id].stats = {m_tasks[id].config.name, 0, 0, 0, 0, 0};
+    }
+}
+
+} // namespace Divacon::Utils
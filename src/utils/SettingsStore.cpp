@@ -5,11 +5,24 @@
 #include "hardware/watchdog.h"
 #include "pico/bootrom.h"
 #include "pico/multicore.h"
+#include "pico/time.h"
+
+#include <algorithm>
+#include <cstddef>
 
 namespace Divacon::Utils {
 
 static uint8_t read_byte(uint32_t offset) { return *(reinterpret_cast<uint8_t *>(XIP_BASE + offset)); }
 
+static bool isErased(uint32_t offset, uint32_t size) {
+    for (uint32_t i = 0; i < size; ++i) {
+        if (read_byte(offset + i) != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
 SettingsStore::SettingsStore()
     : m_store_cache({m_magic_byte,
                      Config::Default::usb_mode,
@@ -22,32 +35,84 @@ SettingsStore::SettingsStore()
                      Config::Default::touch_slider_leds_config.enable_player_color,
                      Config::Default::touch_slider_leds_config.enable_pdloader_support,
                      Config::Default::buttons_config.mirror_to_dpad,
+                     {},
+                     0,
+                     0,
                      {}}),
-      m_dirty(true), m_scheduled_reboot(RebootType::None) {
+      m_dirty(true), m_store_requested(false), m_sector(m_sector_count - 1), m_next_page(0), m_spare_erased(false),
+      m_flash_operations(0), m_longest_stall_us(0), m_scheduled_reboot(RebootType::None) {
 
-    uint32_t current_page = m_flash_offset + m_flash_size - m_store_size;
+    // Find the latest record in each sector. Only records carrying a valid CRC have a meaningful generation. Older
+    // firmware left whatever was in the padding there and only ever used the last sector, so its newest record is
+    // merely a fallback for when this firmware never saved anything.
     bool found_valid = false;
-    for (uint8_t i = 0; i < m_store_pages; ++i) {
-        if (read_byte(current_page) == m_magic_byte) {
-            found_valid = true;
+    bool found_legacy = false;
+    uint32_t legacy_page = 0;
+    for (uint32_t sector = m_sector_count; sector-- > 0;) {
+        for (uint32_t page = m_store_pages; page-- > 0;) {
+            if (read_byte(pageOffset(sector, page)) != m_magic_byte) {
+                continue;
+            }
+
+            const auto &record = *(reinterpret_cast<const Storecache *>(XIP_BASE + pageOffset(sector, page)));
+            if (record.crc != checksum(record)) {
+                // Legacy record, torn write or stale data from other firmware.
+                if (sector == m_sector_count - 1 && !found_legacy) {
+                    found_legacy = true;
+                    legacy_page = page;
+                }
+                continue;
+            }
+
+            if (!found_valid || static_cast<int32_t>(record.generation - m_store_cache.generation) > 0) {
+                m_store_cache = record;
+                m_sector = sector;
+                m_next_page = page + 1;
+                found_valid = true;
+            }
             break;
-        } else {
-            current_page -= m_store_size;
         }
     }
 
-    if (found_valid) {
-        m_store_cache = *(reinterpret_cast<Storecache *>(XIP_BASE + current_page));
-        m_dirty = false;
+    if (!found_valid && found_legacy) {
+        m_store_cache = *(reinterpret_cast<const Storecache *>(XIP_BASE + pageOffset(m_sector_count - 1, legacy_page)));
+        m_store_cache.generation = 0;
+        m_sector = m_sector_count - 1;
+        m_next_page = legacy_page + 1;
+        found_valid = true;
+    }
+
+    m_dirty = !found_valid;
+
+    // Like before, continue after whatever has been programmed already.
+    while (m_next_page < m_store_pages && !isErased(pageOffset(m_sector, m_next_page), m_store_size)) {
+        ++m_next_page;
+    }
+
+    m_spare_erased = isErased(pageOffset(m_sector ^ 1, 0), FLASH_SECTOR_SIZE);
+}
+
+uint32_t SettingsStore::pageOffset(uint32_t sector, uint32_t page) {
+    return m_flash_offset + (sector * FLASH_SECTOR_SIZE) + (page * m_store_size);
+}
+
+uint32_t SettingsStore::checksum(const Storecache &record) {
+    // Plain reflected CRC-32, this only runs at boot and once per save.
+    const auto *data = reinterpret_cast<const uint8_t *>(&record);
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < offsetof(Storecache, crc); ++i) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
     }
+    return ~crc;
 }
 
 void SettingsStore::setUsbMode(usb_mode_t mode) {
     if (mode != m_store_cache.usb_mode) {
         m_store_cache.usb_mode = mode;
         m_dirty = true;
-
-        scheduleReboot();
     }
 }
 
@@ -131,33 +196,95 @@ void SettingsStore::setInputMirrorToDpad(bool do_mirror) {
 
 bool SettingsStore::getLedEnablePdloaderSupport() { return m_store_cache.led_enable_pdloader_support; };
 
-void SettingsStore::store() {
-    if (m_dirty) {
-        multicore_lockout_start_blocking();
-        uint32_t interrupts = save_and_disable_interrupts();
-
-        uint32_t current_page = m_flash_offset;
-        bool do_erase = true;
-        for (uint8_t i = 0; i < m_store_pages; ++i) {
-            if (read_byte(current_page) == 0xFF) {
-                do_erase = false;
-                break;
-            } else {
-                current_page += m_store_size;
-            }
-        }
+void SettingsStore::setUsbPollInterval(usb_mode_t mode, uint8_t interval_ms) {
+    if (mode >= m_usb_mode_count) {
+        return;
+    }
 
-        if (do_erase) {
-            flash_range_erase(m_flash_offset, m_flash_size);
-            current_page = m_flash_offset;
-        }
+    if (getUsbPollInterval(mode) != interval_ms) {
+        m_store_cache.usb_poll_interval[mode] = interval_ms;
+        m_dirty = true;
+    }
+}
+uint8_t SettingsStore::getUsbPollInterval(usb_mode_t mode) {
+    if (mode >= m_usb_mode_count || m_store_cache.usb_poll_interval[mode] == 0) {
+        return Config::Default::usb_poll_interval_ms;
+    }
+    return m_store_cache.usb_poll_interval[mode];
+}
 
-        flash_range_program(current_page, reinterpret_cast<uint8_t *>(&m_store_cache), sizeof(m_store_cache));
+void SettingsStore::program() {
+    if (m_next_page >= m_store_pages) {
+        m_sector ^= 1;
+        m_next_page = 0;
+        m_spare_erased = false;
+    }
+
+    m_store_cache.generation++; // Allowed to wrap, the scan compares generations modulo 2^32.
+    m_store_cache.crc = checksum(m_store_cache);
+
+    const uint32_t start = time_us_32();
+    multicore_lockout_start_blocking();
+    uint32_t interrupts = save_and_disable_interrupts();
+
+    flash_range_program(pageOffset(m_sector, m_next_page), reinterpret_cast<uint8_t *>(&m_store_cache),
+                        sizeof(m_store_cache));
+
+    restore_interrupts_from_disabled(interrupts);
+    multicore_lockout_end_blocking();
+
+    m_longest_stall_us = std::max(m_longest_stall_us, time_us_32() - start);
+    m_flash_operations++;
+
+    m_next_page++;
+    m_dirty = false;
+    m_store_requested = false;
+}
+
+void SettingsStore::eraseSpare() {
+    const uint32_t start = time_us_32();
+    multicore_lockout_start_blocking();
+    uint32_t interrupts = save_and_disable_interrupts();
+
+    flash_range_erase(pageOffset(m_sector ^ 1, 0), FLASH_SECTOR_SIZE);
 
-        m_dirty = false;
+    restore_interrupts_from_disabled(interrupts);
+    multicore_lockout_end_blocking();
+
+    m_longest_stall_us = std::max(m_longest_stall_us, time_us_32() - start);
+    m_flash_operations++;
+
+    m_spare_erased = true;
+}
+
+bool SettingsStore::task(uint32_t idle_ms) {
+    const bool page_available = m_next_page < m_store_pages || m_spare_erased;
+
+    if (m_store_requested && m_dirty && page_available && idle_ms >= m_program_idle_ms) {
+        program();
+        return true;
+    }
+
+    if (!m_spare_erased && idle_ms >= m_erase_idle_ms) {
+        eraseSpare();
+        return true;
+    }
+
+    return false;
+}
+
+void SettingsStore::store() {
+    if (m_scheduled_reboot == RebootType::None) {
+        m_store_requested = m_dirty;
+        return;
+    }
 
-        restore_interrupts_from_disabled(interrupts);
-        multicore_lockout_end_blocking();
+    // About to reboot anyway, no need to be gentle.
+    if (m_dirty) {
+        if (m_next_page >= m_store_pages && !m_spare_erased) {
+            eraseSpare();
+        }
+        program();
     }
 
     switch (m_scheduled_reboot) {
@@ -0,0 +1,46 @@
+#include "utils/XipStats.h"
+
+#if DIVACON_XIP_STATS
+
+#include "hardware/structs/xip_ctrl.h"
+
+#include <array>
+
+namespace Divacon::Utils::XipStats {
+
+namespace {
+
+const static size_t phase_count = static_cast<size_t>(Phase::Count);
+
+const static std::array<const char *, phase_count> phase_names = {
+    "wait", "sample", "menu", "report", "usb", "other",
+};
+
+std::array<Counters, phase_count> counters = {};
+
+uint32_t last_accesses = 0;
+uint32_t last_hits = 0;
+
+} // namespace
+
+void mark(Phase phase) {
+    const uint32_t accesses = xip_ctrl_hw->ctr_acc;
+    const uint32_t hits = xip_ctrl_hw->ctr_hit;
+
+    auto &counter = counters[static_cast<size_t>(phase)];
+    counter.accesses += accesses - last_accesses;
+    counter.hits += hits - last_hits;
+
+    last_accesses = accesses;
+    last_hits = hits;
+}
+
+const char *getName(Phase phase) { return phase_names[static_cast<size_t>(phase)]; }
+
+const Counters &get(Phase phase) { return counters[static_cast<size_t>(phase)]; }
+
+void reset() { counters = {}; }
+
+} // namespace Divacon::Utils::XipStats
+
+#endif // DIVACON_XIP_STATS
@@ -0,0 +1,49 @@
+#ifndef _TESTS_CHECK_H_
+#define _TESTS_CHECK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Minimal assertions for the host tests. Failures are printed and counted, a test returns
+// Test::result() from main().
+
+namespace Divacon::Test {
+
+inline uint32_t &failures() {
+    static uint32_t count = 0;
+    return count;
+}
+
+inline void fail(const char *file, int line, const char *expression, long long actual, long long expected) {
+    printf("%s:%d: CHECK(%s) failed, got %lld expected %lld\n", file, line, expression, actual, expected);
+    failures()++;
+}
+
+inline int result() {
+    if (failures()) {
+        printf("%u check(s) failed\n", static_cast<unsigned>(failures()));
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace Divacon::Test
+
+#define CHECK(condition)                                                                                               \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            Divacon::Test::fail(__FILE__, __LINE__, #condition, 0, 1);                                                 \
+        }                                                                                                              \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                                                     \
+    do {                                                                                                               \
+        const auto check_actual = (actual);                                                                            \
+        const auto check_expected = (expected);                                                                        \
+        if (!(check_actual == check_expected)) {                                                                       \
+            Divacon::Test::fail(__FILE__, __LINE__, #actual " == " #expected, (long long)check_actual,                 \
+                                (long long)check_expected);                                                            \
+        }                                                                                                              \
+    } while (0)
+
+#endif // _TESTS_CHECK_H_
@@ -0,0 +1,80 @@
+#include "usb/descriptor.h"
+
+#include "Check.h"
+
+#include <array>
+#include <string.h>
+
+namespace {
+
+const uint8_t interval_offset = 6;
+const size_t interrupt_in_offset = 27;
+const size_t interrupt_out_offset = 34;
+const size_t bulk_in_offset = 41;
+
+// Configuration with one HID interface and an interrupt IN, interrupt OUT and bulk IN endpoint.
+const std::array<uint8_t, 48> config = {
+    9, 0x02, 48, 0, 1, 1, 0, 0x80, 50,     // Configuration
+    9, 0x04, 0, 0, 3, 0x03, 0, 0, 0,       // Interface
+    9, 0x21, 0x11, 0x01, 0, 1, 0x22, 0, 0, // HID
+    7, 0x05, 0x81, 0x03, 64, 0, 1,         // Interrupt IN
+    7, 0x05, 0x01, 0x03, 64, 0, 1,         // Interrupt OUT
+    7, 0x05, 0x82, 0x02, 64, 0, 0,         // Bulk IN
+};
+
+void testPatchesInterruptInOnly() {
+    std::array<uint8_t, 64> dst = {};
+
+    CHECK_EQ(usbd_desc_cfg_set_interval(dst.data(), dst.size(), config.data(), 8), config.size());
+
+    for (size_t idx = 0; idx < config.size(); ++idx) {
+        const uint8_t expected = idx == interrupt_in_offset + interval_offset ? 8 : config[idx];
+        CHECK_EQ(dst[idx], expected);
+    }
+    CHECK_EQ(dst[interrupt_out_offset + interval_offset], 1);
+    CHECK_EQ(dst[bulk_in_offset + interval_offset], 0);
+}
+
+void testRejectsTooSmallDestination() {
+    std::array<uint8_t, 47> dst = {};
+
+    CHECK_EQ(usbd_desc_cfg_set_interval(dst.data(), dst.size(), config.data(), 8), 0);
+}
+
+void testRejectsOtherDescriptorTypes() {
+    std::array<uint8_t, 64> dst = {};
+    auto src = config;
+    src[1] = 0x01;
+
+    CHECK_EQ(usbd_desc_cfg_set_interval(dst.data(), dst.size(), src.data(), 8), 0);
+}
+
+void testRejectsMalformedDescriptors() {
+    std::array<uint8_t, 64> dst = {};
+
+    // A zero length descriptor would never advance.
+    auto zero_length = config;
+    zero_length[interrupt_out_offset] = 0;
+    CHECK_EQ(usbd_desc_cfg_set_interval(dst.data(), dst.size(), zero_length.data(), 8), 0);
+
+    // The last descriptor reaches past the total length.
+    auto overrun = config;
+    overrun[bulk_in_offset] = 9;
+    CHECK_EQ(usbd_desc_cfg_set_interval(dst.data(), dst.size(), overrun.data(), 8), 0);
+
+    // Total length shorter than the configuration descriptor itself.
+    auto short_total = config;
+    short_total[2] = 8;
+    CHECK_EQ(usbd_desc_cfg_set_interval(dst.data(), dst.size(), short_total.data(), 8), 0);
+}
+
+} // namespace
+
+int main() {
+    testPatchesInterruptInOnly();
+    testRejectsTooSmallDestination();
+    testRejectsOtherDescriptorTypes();
+    testRejectsMalformedDescriptors();
+
+    return Divacon::Test::result();
+}
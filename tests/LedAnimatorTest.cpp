@@ -0,0 +1,308 @@
+#include "peripherals/TouchSliderLeds.h"
+#include "utils/LedAnimator.h"
+
+#include "Check.h"
+#include "LedTestConfig.h"
+
+#include "pico/rand.h"
+#include "pio_ws2812/ws2812.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+
+using Divacon::Peripherals::TouchSliderLeds;
+using Divacon::Utils::LedAnimator;
+using Color = LedAnimator::Color;
+using IdleMode = TouchSliderLeds::Config::IdleMode;
+using TouchedMode = TouchSliderLeds::Config::TouchedMode;
+
+namespace {
+
+const size_t SEGMENT_COUNT = LedAnimator::SEGMENT_COUNT;
+const uint32_t FRAME_INTERVAL_US = Divacon::Test::LED_FRAME_INTERVAL_US;
+
+// The idle and touched modes as they were written before the effect tables, with the function level statics moved
+// into the instance. Colors are dimmed in whole numbers instead of floats, whose products sometimes landed just below
+// the whole result and were cut down by one. Everything else is unchanged.
+class SwitchReference {
+  private:
+    struct AnimationStepper {
+        const uint32_t steps_to_advance;
+        uint32_t current_steps;
+
+        uint32_t advance(uint32_t steps) {
+            current_steps += steps;
+            if (current_steps < steps_to_advance) {
+                return 0;
+            }
+
+            const auto advance = current_steps / steps_to_advance;
+
+            current_steps %= steps_to_advance;
+
+            return advance;
+        }
+    };
+
+    static const uint8_t pulse_dim_percent_min = 40;
+    static const uint8_t pulse_dim_percent_max = 100;
+
+    static const size_t rainbow_length = 40;
+    static constexpr std::array<std::array<Color, rainbow_length>, 2> rainbow_colors{{
+        {{
+            {0x5a, 0x3a, 0xc6}, {0x76, 0x36, 0xaa}, {0x91, 0x34, 0x8e}, {0xad, 0x30, 0x72}, {0xca, 0x2e, 0x56},
+            {0xe6, 0x2a, 0x3a}, {0xf2, 0x2f, 0x2b}, {0xe6, 0x42, 0x33}, {0xce, 0x5c, 0x46}, {0xb6, 0x74, 0x59},
+            {0x9e, 0x8d, 0x6c}, {0x86, 0xa6, 0x7e}, {0x6e, 0xbf, 0x90}, {0x57, 0xd8, 0xa3}, {0x4c, 0xea, 0xac},
+            {0x58, 0xf0, 0xa3}, {0x6d, 0xf0, 0x92}, {0x83, 0xf0, 0x82}, {0x99, 0xf0, 0x72}, {0xae, 0xf0, 0x61},
+            {0xc4, 0xf0, 0x50}, {0xdb, 0xf0, 0x40}, {0xec, 0xea, 0x34}, {0xf2, 0xdc, 0x34}, {0xf4, 0xc9, 0x38},
+            {0xf6, 0xb6, 0x3c}, {0xf8, 0xa2, 0x40}, {0xfa, 0x90, 0x45}, {0xfc, 0x7d, 0x49}, {0xfe, 0x6a, 0x4d},
+            {0xf8, 0x5c, 0x56}, {0xe2, 0x56, 0x68}, {0xc6, 0x52, 0x7d}, {0xaa, 0x50, 0x93}, {0x8e, 0x4c, 0xa9},
+            {0x72, 0x4a, 0xbf}, {0x56, 0x46, 0xd5}, {0x3a, 0x44, 0xeb}, {0x2e, 0x40, 0xf3}, {0x3e, 0x3c, 0xe2},
+        }},
+        {{
+            {0x68, 0x38, 0xb7}, {0x83, 0x35, 0x9c}, {0x9f, 0x32, 0x80}, {0xbb, 0x2f, 0x64}, {0xd8, 0x2c, 0x48},
+            {0xf3, 0x29, 0x2c}, {0xf2, 0x35, 0x2a}, {0xda, 0x4f, 0x3c}, {0xc3, 0x68, 0x50}, {0xaa, 0x81, 0x62},
+            {0x92, 0x99, 0x75}, {0x7a, 0xb2, 0x87}, {0x63, 0xcc, 0x9a}, {0x4b, 0xe5, 0xac}, {0x4d, 0xf0, 0xab},
+            {0x62, 0xf0, 0x9b}, {0x78, 0xf0, 0x8a}, {0x8e, 0xf0, 0x7a}, {0xa4, 0xf0, 0x69}, {0xb9, 0xf0, 0x59},
+            {0xd0, 0xf0, 0x48}, {0xe6, 0xf0, 0x37}, {0xf1, 0xe5, 0x32}, {0xf3, 0xd2, 0x36}, {0xf5, 0xc0, 0x3a},
+            {0xf7, 0xac, 0x3e}, {0xf9, 0x99, 0x43}, {0xfb, 0x86, 0x47}, {0xfd, 0x74, 0x4b}, {0xff, 0x61, 0x4f},
+            {0xf0, 0x57, 0x5d}, {0xd4, 0x54, 0x72}, {0xb7, 0x51, 0x88}, {0x9c, 0x4e, 0x9e}, {0x80, 0x4b, 0xb4},
+            {0x64, 0x48, 0xca}, {0x48, 0x45, 0xe0}, {0x2c, 0x42, 0xf6}, {0x2f, 0x3e, 0xf0}, {0x4c, 0x3b, 0xd4},
+        }},
+    }};
+
+    static Color dim_color(const Color &color, uint8_t dim_percent) {
+        return Color{
+            .r = (uint8_t)(color.r * dim_percent / 100),
+            .g = (uint8_t)(color.g * dim_percent / 100),
+            .b = (uint8_t)(color.b * dim_percent / 100),
+        };
+    }
+
+    static Color max_color(const Color &a, const Color &b) {
+        return Color{
+            .r = std::max(a.r, b.r),
+            .g = std::max(a.g, b.g),
+            .b = std::max(a.b, b.b),
+        };
+    }
+
+    AnimationStepper m_pulse_stepper{4096, 0};
+    uint8_t m_pulse_dim_percent = pulse_dim_percent_max;
+    int8_t m_pulse_advance_factor = -1;
+
+    AnimationStepper m_rainbow_stepper{4096, 0};
+    size_t m_rainbow_position;
+
+    AnimationStepper m_fade_stepper{2048, 0};
+    std::array<uint8_t, SEGMENT_COUNT> m_fade_percent = {};
+
+    AnimationStepper m_blend_stepper{128, 0};
+    uint8_t m_blend_percent = 100;
+
+    LedAnimator::Frame m_idle_buffer = {};
+    LedAnimator::Frame m_touched_buffer = {};
+
+  public:
+    IdleMode idle_mode;
+    TouchedMode touched_mode;
+    Color idle_color;
+    Color touched_color;
+    uint32_t touched = 0;
+
+    SwitchReference(size_t rainbow_position) : m_rainbow_position(rainbow_position) {}
+
+    void updateIdle(uint32_t steps) {
+        if (steps <= 0) {
+            return;
+        }
+
+        switch (idle_mode) {
+        case IdleMode::Off:
+            m_idle_buffer.fill({0x00, 0x00, 0x00});
+            break;
+        case IdleMode::Static:
+            m_idle_buffer.fill(idle_color);
+            break;
+        case IdleMode::Pulse: {
+            const auto advance = m_pulse_stepper.advance(steps);
+
+            if (m_pulse_advance_factor < 0 && advance >= (uint8_t)(m_pulse_dim_percent - pulse_dim_percent_min)) {
+                m_pulse_dim_percent = pulse_dim_percent_min;
+                m_pulse_advance_factor = -m_pulse_advance_factor;
+            } else if (m_pulse_advance_factor > 0 && advance + m_pulse_dim_percent >= pulse_dim_percent_max) {
+                m_pulse_dim_percent = pulse_dim_percent_max;
+                m_pulse_advance_factor = -m_pulse_advance_factor;
+            } else {
+                m_pulse_dim_percent = m_pulse_dim_percent + (m_pulse_advance_factor * advance);
+            }
+
+            m_idle_buffer.fill(dim_color(idle_color, m_pulse_dim_percent));
+        } break;
+        case IdleMode::RainbowCycle:
+            m_rainbow_position =
+                (m_rainbow_position + m_rainbow_stepper.advance(steps)) % (rainbow_length * rainbow_colors.size());
+            [[fallthrough]];
+        case IdleMode::RainbowStatic: {
+            const auto frame = m_rainbow_position % rainbow_colors.size();
+            const auto frame_position = m_rainbow_position / rainbow_colors.size();
+
+            for (size_t idx = 0; idx < m_idle_buffer.size(); ++idx) {
+                size_t offset = (frame_position + idx) % rainbow_length;
+                m_idle_buffer[idx] = rainbow_colors[frame][offset];
+            }
+        } break;
+        }
+    }
+
+    void updateTouched(uint32_t steps) {
+        switch (touched_mode) {
+        case TouchedMode::Off:
+            m_touched_buffer.fill({0x00, 0x00, 0x00});
+            break;
+        case TouchedMode::Idle:
+            std::copy(m_idle_buffer.cbegin(), m_idle_buffer.cend(), m_touched_buffer.begin());
+            break;
+        case TouchedMode::Touched:
+            for (size_t idx = 0; idx < SEGMENT_COUNT; ++idx) {
+                if (touched & ((uint32_t)0x80000000 >> idx)) {
+                    m_touched_buffer[idx] = touched_color;
+                } else {
+                    m_touched_buffer[idx] = {0x00, 0x00, 0x00};
+                }
+            }
+            break;
+        case TouchedMode::TouchedFade:
+        case TouchedMode::TouchedIdle: {
+            const auto advance = m_fade_stepper.advance(steps);
+
+            for (size_t idx = 0; idx < SEGMENT_COUNT; ++idx) {
+                if (touched & ((uint32_t)0x80000000 >> idx)) {
+                    m_touched_buffer[idx] =
+                        touched_mode == TouchedMode::TouchedFade ? touched_color : m_idle_buffer[idx];
+                    m_fade_percent[idx] = 100;
+                } else {
+                    m_touched_buffer[idx] = dim_color(m_touched_buffer[idx], m_fade_percent[idx]);
+                    m_fade_percent[idx] = advance > m_fade_percent[idx] ? 0 : m_fade_percent[idx] - advance;
+                }
+            }
+        } break;
+        }
+    }
+
+    LedAnimator::Frame render(uint32_t steps) {
+        const auto blend_advance = m_blend_stepper.advance(steps);
+        if (touched) {
+            m_blend_percent = blend_advance > m_blend_percent ? 0 : m_blend_percent - blend_advance;
+        } else {
+            m_blend_percent = blend_advance + m_blend_percent > 100 ? 100 : m_blend_percent + blend_advance;
+        }
+
+        LedAnimator::Frame frame;
+        for (size_t idx = 0; idx < SEGMENT_COUNT; ++idx) {
+            frame[idx] = max_color(dim_color(m_idle_buffer[idx], m_blend_percent), m_touched_buffer[idx]);
+        }
+        return frame;
+    }
+
+    LedAnimator::Frame update(uint32_t steps) {
+        updateIdle(steps);
+        updateTouched(steps);
+        return render(steps);
+    }
+};
+
+TouchSliderLeds::Config makeConfig(IdleMode idle_mode, TouchedMode touched_mode, uint8_t animation_speed) {
+    auto config = Divacon::Test::ledTestConfig();
+    config.animation_speed = animation_speed;
+    config.idle_mode = idle_mode;
+    config.touched_mode = touched_mode;
+    config.idle_color = {200, 120, 40};
+    return config;
+}
+
+struct Random {
+    uint32_t state;
+
+    uint32_t next() {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    }
+};
+
+// Runs the effect tables of one mode pair through TouchSliderLeds on a fake clock and compares every sent frame with
+// the switch based modes. Touches are held and released for random lengths, so fades and the blend run to the end.
+// Returns the number of frames which differ.
+size_t compareModes(IdleMode idle_mode, TouchedMode touched_mode, uint8_t animation_speed, size_t frames) {
+    // The animator starts the rainbow at `seed % 80`, the old code used `seed % 40` and never started on the second
+    // phase.
+    const uint64_t rand_state = static_cast<uint64_t>(idle_mode) * 5 + static_cast<uint64_t>(touched_mode);
+    Divacon::Test::randState() = rand_state;
+    const uint32_t seed = get_rand_32();
+    Divacon::Test::randState() = rand_state;
+
+    const auto config = makeConfig(idle_mode, touched_mode, animation_speed);
+    TouchSliderLeds leds(config);
+
+    SwitchReference reference(seed % 80);
+    reference.idle_mode = idle_mode;
+    reference.touched_mode = touched_mode;
+    reference.idle_color = config.idle_color;
+    reference.touched_color = config.touched_color;
+
+    Random random = {seed};
+    size_t next_touch_frame = 0;
+    size_t differing_frames = 0;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        if (frame == next_touch_frame) {
+            reference.touched = (random.next() % 2 == 0) ? 0 : random.next();
+            leds.setTouched(reference.touched);
+            next_touch_frame += 1 + random.next() % (frames / 4);
+        }
+
+        leds.update(frame * FRAME_INTERVAL_US);
+        const auto expected = reference.update(animation_speed * FRAME_INTERVAL_US / 1000);
+
+        const auto &strip = Divacon::Test::ws2812();
+        bool differs = false;
+        for (size_t segment = 0; segment < SEGMENT_COUNT; ++segment) {
+            const Color &color = expected[segment];
+            differs |= strip.front[segment] != ws2812_rgb_to_u32pixel(color.r, color.g, color.b);
+        }
+
+        if (differs && differing_frames == 0) {
+            printf("idle mode %u, touched mode %u, speed %u: frame %zu differs\n", static_cast<unsigned>(idle_mode),
+                   static_cast<unsigned>(touched_mode), animation_speed, frame);
+        }
+        differing_frames += differs;
+    }
+
+    return differing_frames;
+}
+
+// Every combination from a fresh start, switching touched modes on the way isn't compared. The old modes shared their
+// fade state and left it stale while a mode without fading was active.
+void testEffectTablesMatchSwitchModes(uint8_t animation_speed, size_t frames) {
+    const IdleMode idle_modes[] = {IdleMode::Off, IdleMode::Static, IdleMode::Pulse, IdleMode::RainbowStatic,
+                                   IdleMode::RainbowCycle};
+    const TouchedMode touched_modes[] = {TouchedMode::Off, TouchedMode::Idle, TouchedMode::Touched,
+                                         TouchedMode::TouchedFade, TouchedMode::TouchedIdle};
+
+    for (const auto idle_mode : idle_modes) {
+        for (const auto touched_mode : touched_modes) {
+            CHECK_EQ(compareModes(idle_mode, touched_mode, animation_speed, frames), 0u);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    // At most one pulse or rainbow position per frame, the old pulse lost what went past its turning points. A full
+    // pulse takes 1928 frames at the highest speed and 13285 frames at the lower one.
+    testEffectTablesMatchSwitchModes(255, 4000);
+    testEffectTablesMatchSwitchModes(37, 16000);
+
+    return Divacon::Test::result();
+}
@@ -0,0 +1,40 @@
+#ifndef _TESTS_LEDTESTCONFIG_H_
+#define _TESTS_LEDTESTCONFIG_H_
+
+#include "peripherals/TouchSliderLeds.h"
+
+#include <stdint.h>
+
+namespace Divacon::Test {
+
+const uint32_t LED_FRAME_INTERVAL_US = 1000;
+
+// One strip over the whole slider at full brightness, without gamma, calibration or current limit, so the animator's
+// colors reach the strip unchanged. Fields are set by name, tests override the ones they care about the same way.
+inline Peripherals::TouchSliderLeds::Config ledTestConfig() {
+    using Config = Peripherals::TouchSliderLeds::Config;
+
+    Config config = {};
+    config.strips[0] = {0, 0, Utils::LedAnimator::SEGMENT_COUNT, false};
+    config.strip_count = 1;
+    config.is_rgbw = false;
+    config.leds_per_segment = 1;
+    config.gamma_correction = false;
+    config.calibration = {255, 255, 255};
+    config.channel_current_ma = 20;
+    config.max_current_ma = 0;
+    config.target_fps = 1000000 / LED_FRAME_INTERVAL_US;
+    config.brightness = 255;
+    config.animation_speed = 50; // Steps per millisecond
+    config.idle_mode = Config::IdleMode::Static;
+    config.touched_mode = Config::TouchedMode::Touched;
+    config.idle_color = {64, 64, 64};
+    config.touched_color = {138, 254, 171};
+    config.enable_player_color = false;
+    config.enable_pdloader_support = true;
+    return config;
+}
+
+} // namespace Divacon::Test
+
+#endif // _TESTS_LEDTESTCONFIG_H_
@@ -0,0 +1,312 @@
+#include "utils/ModExp.h"
+
+#include "Check.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+using Divacon::Utils::ModExp;
+
+namespace {
+
+struct Vector {
+    const char *base;
+    const char *exponent;
+    const char *modulus;
+    const char *result;
+};
+
+// Generated with Python's pow().
+const Vector vectors[] = {
+    {"c30b0ad806fa976950a26b7bc53a1cac12f50822cc56d6dd2010874c6f79014cfa5931e9c6ed818233701f30ff945ad0"
+     "4b274a48d473d7a13b71f0e3ba5280650c8583acd9f10ff319951e7cfb012f2b38bd660b8b9527c27633d9c9f3db3160"
+     "fb3d9942aa19e33294c07740125ff4671b73bcf3a7c8dd326fa71010aa25622f94b374058e65bf1aecff3c9f4c4731ff"
+     "795431e20ff6d8a0826551d2005977a1fa0c6f5f6461678f166387fbfa9e952eec30ec6bf0ce1eb2998b5fad41bd1017"
+     "7e5ee7dc54ab3b84f740f650369618494e72be975b698a9a82d8265bde87ed4ed639d7cbd10cfa4d2a9e5a896ad95331"
+     "0ef552b5165bee86a54f6e32964c6e4c",
+     "78053996539da442ad324ff35b89060d76a7df5ed8e14ed342dccee63d5918faf1ef7d6b84c07745589685f6e53f6b6a"
+     "b9a35b1dd51caa2697428faff9282f1f022a5bc8d56ad33f52528211c0801cf0a867c129037f518b26069441b9c4b830"
+     "a60a84d12189a5d72f25dac6e2f67cc1a94308921b15bb0d61893235359cebcff1517f4ee150f5d12be0e9710cbc58f1"
+     "590b2a41f24bad31a58cf4e2272e6c339d79ae37d7ed4f546f13ee4eda0d033dc68389db751506f1726946abfc833f1a"
+     "5c6a05c07e6d8d0a762b6f6c1176ae8b7fce715d7f6ac297f8c09c7cbb19c8d98ff082576273c7bf455f5346316e689a"
+     "4ce458c9335049e1d11728444b5c9ebe",
+     "c9acd75c9d4caa353f4440d7d0ad45b1e56981da2aeb9bbee9916285fc7dd5f816f8e32ea40a6f31c94d1d52d3c55618"
+     "0cb93e5b0661cdc8299c8001751eb87e437b2ecbf3fe91b4a08c9810432a6df3a16fd91d02ebe04c0072f2f6d0ccf8a0"
+     "ee962cf5c58f66862b6ea9bf52910f67eee2ab9acce85490bb4d75db148d07265ad97c695a6120baf861b961ff83f1b1"
+     "5ed657f7dd9f4c9e9e0edfdb17f91e9975588a0fc2b676c73ae8f3d1fd00fc07b5ab1fe60b25e51d0afafe9c2ad43583"
+     "cef5515328fa55ac595a4a9b82c0da20e00f073fd4b6d7dc684acccff9bc17e07c00ade07f071a83ce1efb2f9200adf3"
+     "54a00ec78eedd6c8da04433461c2df27",
+     "02247b9bc83f8025f9e0d23c238db3a59b0975ff80fa547d00597fb7d781dc75c175bab842b97d7016d2bf62b24eb164"
+     "7e323778a17b7ba1d4eacb4aa56e89d36103db1177278de99cebd65b8df097a8e76ff81fda7b0107740f8d5f0a905fcd"
+     "bcd85bb40711d7b957b5ae8c0ff79f79525ab2fd218f0e59731142ca239e1be31dfea06436cb2069ac6c031b54a20160"
+     "a6c8feb7cc59ea8f119ef3d11309719b449fa0c92f922119ff271a9cc1563eacb91e5d2b888ebcdda115c408f39023fb"
+     "5eba591b75ead9b5f9ae63f5def7e8e0fa2525abddc72b72835ee59717673e4cea120818ea114b7204c3f117f484939d"
+     "b47b23ead5dd7e5c27138554d0cf2856"},
+    {"d08084eca6d7be88b2e02f94d1e854f4be40225991fcec749e1447a7941d8d5ba67d2449f9a2fd5c89d2f46516f1c760"
+     "f086a4fc4f62ff8cc092c82e312251c14d67c3f6dd33ffcc65b9e312ef5c227a7a5297588d660fc026bafaaea2c36c28"
+     "ec80f08fd16b3a7f6100400f5934e6e178abbf8fbc27efda1af08ce8d5178cb208adb23da0c6262044b4d1b85cd3c89c"
+     "875d66f74e840ec4237a585cabfd58b965198a8d72dbaaa4edbbc2f6d7fc8caa1e7a7f151b3d0a5a1bc3a0ed2c0c0585"
+     "eb849abaa644fdf56373f647f93e47e977cf13a7dc88f312b72e611d4fc30a3cdfdf35fe1fce692c848bc1b2aca3fd7b"
+     "90f9a07599b24080ef984c976aa5464b9e2193f6fcc11cf2f82842caf0aead36d45c393563038d869e660bb688621ba7"
+     "da13c3c45eeaf7149d1c1fea3a0662c59a1d06acef258cf9442e0e66a1881eb3b5186e8f27bba4a173d608092488165a"
+     "5ff98d3a4652692183977548775772f7cb3d6cfb937a9e498659d58218ea54faeaa71debae7ee4fc0d5ed73970e6264d"
+     "25b0cd531eccf8858cdb9022c94adc27105d54f8317fd7ec04f0ed074431d0ac3e375a98fa8277ed5ffdd3478a3b8646"
+     "ae5c8fb32ffbeea296de2852c28852f7b236798f9a9a1cccde3415e1f80dc5dba175e9b014ec794028cb9c8d80e9bc2b"
+     "63cb10b46f18ade036d5869f4da5c35498bffd7536232753673815c23682713d",
+     "3320c6",
+     "f1d7f8b1a9a1d43ff1f979b48f3a7c02410b80fd2a96b599528776f6cdf5c93f14f757785503380e8696a1ac72b7c8b9"
+     "b87666acd792e373b04ae6801ca7e65a431a504d7222a8df23dcc0a9aebb64682072fb48f857c9ebb27b187611642769"
+     "939ecd76c51debdbe38aece077ddf720dadd32ac6efe6d2e77495168532dfa7f19eb33fc9e6453d8d40afe8fe42da89e"
+     "8c724c8c985e00eb3eefa51a294673ebe18efff468436f14fc82a4609589da20c6cc47740f41cf566372a32c83d6f2a0"
+     "96e5d0ed84a877a785e9fdcf2a0a625646be8171a18f6f4321ab33f37632e4ce73244a7b1278088036dc683ec7729912"
+     "0f508554cd71dd289852e877eeb266c3",
+     "e8c9092e7195a4b08007141c85abcbfc941de6a539a1966cf621a53c035bf9ff85d8ae407baeb07083cd24e5cc2874e7"
+     "4dcfd9abc27b942c397dec6729ad4718b70d3b38a5191ede1be1a0e40273edd5b07a54b6f5fd31fb038a12509546868f"
+     "6c32eed905a4e78a085bd5043547ac469392a1d4174e8c5473d95a59db2bd03e3619bcfc61ebda55039d78990a36946b"
+     "5e763d19c6e9ba39076751b313569b4a057ad83917aded230b8e53be96b5ca2b81d29d3415b39a2202607f8c6b6826cd"
+     "ba543b7a4b720c1020940d9a73e219b9111d76cfdd463a50046861c17c9bb061f40fa4aed8a8c90d568cf8bf86845c35"
+     "3d3a90952b217cbc7f79adb5cbb32b8f"},
+    {"ae5aed02866dd2fe5999000b19599318850c9b848d8a228bbbef70e0c4a4406e2abbe6e7284ca6ffccc592217e05d8e4"
+     "66365d02c2f6ef6da55d29c670bd1f7ed978c859471e3461a6f16c328d000359ff06cb712ea2d053296b68a0ddda170c"
+     "bdda340d6a4fa357150baa502f1a6317e65a0b49fb1d896850c1e5a06071f461dee6add3eafc93601c904d72780f3124"
+     "28701d2009f21c6d793bff2b1edfcd6dd698a1ae538819c069e4d6f6a3fbdf20deddc4970a4aac4867083407819485f9"
+     "29c06bd3adc191e1c3e44e2fd66d2fb52087c8b5841f44e417e00cbaaa9e42dd3070133b644e347fdc542dacd6707b11"
+     "425aaef24016702be83e7cb162332433",
+     "d02e3bf012b68651af1f0ce449e0fa8cc90d3ba9096732d49d6f36277f9b111451a369645221206228071e2c950215fe"
+     "04b71cc9abe9d3d18b1d12eca9c4983099ca4795d3011c77b4f381dc948e3b77915013143fcbc1fdb4475ede879227d8"
+     "37a190ae1617364bd1cab8622cee4845a10b071086e65cb8db8befb62d0b0571",
+     "a1b5c313f7aa10341f7379c88e8f0b862bd48e3b07ff945c35f3399f3e58d71a9120c9f8772cd60af0e9a43f8c0ea45a"
+     "fa17af9101ba02e7fd7ecf3c42a6c4b7c43e732f1fc60468789578856d997f419d168db564dc5aafb44eaca3ff994de8"
+     "45c18b734fa2952a69f1519182852a82b2bb39cf2aa90b890ac5fd4695348011",
+     "4d8e0632ed132f142003a81dee309bf7d584c69d932b87dd5cd8c5f182a2ee4743e97c29628523749363c19240ec2cf7"
+     "5e4ab570171c3b4785c1e8ea5a4d5cf7302db412f55279995c50b50fe066f194f8ac8b2ff9c917aab0f7edd676ae6a4b"
+     "64fab8ce1c0f6273974d9cef73d05268299be9a3128cd465e17a4dc10a474ff7"},
+    {"0679af73d2ff20d762fa3972a5b8603e093c1acfa9d88bc8034cc0400f9ed1dfbf9c2350d1868da9143c84d0c5e90360"
+     "ba7daf286a876394dc9f7276f619ca48fbaca85a54845cf0cd8b382b567c4d9c439a3434876d2d3894ffd33754d9ddaa"
+     "8613cdfe",
+     "adb21af1649add250554ed46b89a8f03832be2ba14a6a0a497689a1c475b95468603aa054286bc97a036e8348dff45fa"
+     "c05d5ebb0d40a677a394472561",
+     "f652643920538387ae6295062fef15ed5af1d0e3103f35e01cfe3516862078f1b50dbc7010aa394057f8ddb4d7494b41"
+     "682cd8b01b6644fb4d1481cd87",
+     "b550816d47403c7aac13985d1cfe9f029d76c3d8312f98ce895826eab285f4645295ebc0ac3f600e28266c7def6f4ffb"
+     "eb7cc8c32179aa22628bd39517"},
+    {"22ef55016b4d7fcd33bb525f586b1d0d",
+     "",
+     "954e694d3c6f815b",
+     "0000000000000001"},
+};
+
+std::vector<uint8_t> fromHex(const char *hex) {
+    std::vector<uint8_t> bytes(strlen(hex) / 2);
+    for (size_t idx = 0; idx < bytes.size(); ++idx) {
+        unsigned value = 0;
+        sscanf(hex + idx * 2, "%2x", &value);
+        bytes[idx] = static_cast<uint8_t>(value);
+    }
+    return bytes;
+}
+
+size_t run(ModExp &exp) {
+    size_t steps = 1;
+    while (!exp.step() && steps < 1000000) {
+        ++steps;
+    }
+    return steps;
+}
+
+uint64_t reference(uint64_t base_high, uint64_t base_low, uint64_t exponent, uint64_t modulus) {
+    using uint128_t = unsigned __int128;
+
+    uint64_t base = ((static_cast<uint128_t>(base_high) << 64) | base_low) % modulus;
+    uint64_t result = 1 % modulus;
+    for (; exponent; exponent >>= 1) {
+        if (exponent & 1) {
+            result = static_cast<uint128_t>(result) * base % modulus;
+        }
+        base = static_cast<uint128_t>(base) * base % modulus;
+    }
+    return result;
+}
+
+std::vector<uint8_t> toBytes(uint64_t value) {
+    std::vector<uint8_t> bytes(8);
+    for (size_t idx = 0; idx < bytes.size(); ++idx) {
+        bytes[7 - idx] = static_cast<uint8_t>(value >> (idx * 8));
+    }
+    return bytes;
+}
+
+void testVectors() {
+    for (const auto &vector : vectors) {
+        const auto base = fromHex(vector.base);
+        const auto exponent = fromHex(vector.exponent);
+        const auto modulus = fromHex(vector.modulus);
+        const auto expected = fromHex(vector.result);
+
+        ModExp exp;
+        CHECK(exp.begin(base.data(), base.size(), exponent.data(), exponent.size(), modulus.data(), modulus.size()));
+        CHECK(!exp.done());
+        run(exp);
+        CHECK(exp.done());
+
+        std::vector<uint8_t> result(expected.size());
+        exp.getResult(result.data(), result.size());
+        CHECK(result == expected);
+    }
+}
+
+// Random 64 bit moduli, checked against 128 bit arithmetic.
+void testSmall() {
+    uint64_t state = 0x2040;
+    const auto next = [&]() {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return state;
+    };
+
+    for (size_t round = 0; round < 200; ++round) {
+        const uint64_t modulus = next() | 1;
+        const uint64_t base_high = next();
+        const uint64_t base_low = next();
+        const uint64_t exponent = next() >> (round % 64);
+
+        std::vector<uint8_t> base = toBytes(base_high);
+        const auto low = toBytes(base_low);
+        base.insert(base.end(), low.begin(), low.end());
+        const auto exponent_bytes = toBytes(exponent);
+        const auto modulus_bytes = toBytes(modulus);
+
+        ModExp exp;
+        CHECK(exp.begin(base.data(), base.size(), exponent_bytes.data(), exponent_bytes.size(), modulus_bytes.data(),
+                        modulus_bytes.size()));
+        run(exp);
+
+        uint8_t result[8];
+        exp.getResult(result, sizeof(result));
+        CHECK(std::vector<uint8_t>(result, result + 8) == toBytes(reference(base_high, base_low, exponent, modulus)));
+
+        CHECK(exp.beginPublic(base.data(), base.size(), exponent_bytes.data(), exponent_bytes.size(),
+                              modulus_bytes.data(), modulus_bytes.size()));
+        run(exp);
+
+        exp.getResult(result, sizeof(result));
+        CHECK(std::vector<uint8_t>(result, result + 8) == toBytes(reference(base_high, base_low, exponent, modulus)));
+
+        // a * b mod modulus, with b as long as the modulus.
+        const uint64_t factor = next();
+        const auto factor_bytes = toBytes(factor);
+        CHECK(exp.beginMultiply(base.data(), base.size(), factor_bytes.data(), factor_bytes.size(),
+                                modulus_bytes.data(), modulus_bytes.size()));
+        run(exp);
+
+        exp.getResult(result, sizeof(result));
+        const uint64_t product =
+            static_cast<unsigned __int128>(reference(base_high, base_low, 1, modulus)) * factor % modulus;
+        CHECK(std::vector<uint8_t>(result, result + 8) == toBytes(product));
+    }
+}
+
+// A second begin() abandons the exponentiation in progress, even halfway through a multiplication.
+void testRestart() {
+    const auto &vector = vectors[0];
+    const auto base = fromHex(vector.base);
+    const auto exponent = fromHex(vector.exponent);
+    const auto modulus = fromHex(vector.modulus);
+    const auto expected = fromHex(vector.result);
+
+    ModExp exp;
+    CHECK(exp.begin(modulus.data(), modulus.size(), modulus.data(), modulus.size(), modulus.data(), modulus.size()));
+    for (size_t step = 0; step < 200; ++step) {
+        exp.step();
+    }
+
+    CHECK(exp.begin(base.data(), base.size(), exponent.data(), exponent.size(), modulus.data(), modulus.size()));
+    run(exp);
+
+    std::vector<uint8_t> result(expected.size());
+    exp.getResult(result.data(), result.size());
+    CHECK(result == expected);
+}
+
+// Secret exponents take the same number of steps whatever their value and length, public ones only as many as their
+// bit length needs.
+void testConstantSteps() {
+    const auto &vector = vectors[0];
+    const auto base = fromHex(vector.base);
+    const auto exponent = fromHex(vector.exponent);
+    const auto modulus = fromHex(vector.modulus);
+
+    ModExp exp;
+    CHECK(exp.begin(base.data(), base.size(), exponent.data(), exponent.size(), modulus.data(), modulus.size()));
+    const size_t steps = run(exp);
+
+    // The high 129 bits cleared, passed in full and without the leading zero bytes.
+    auto short_exponent = exponent;
+    std::fill_n(short_exponent.begin(), 16, 0);
+    short_exponent[16] &= 0x7F;
+
+    std::vector<uint8_t> padded_result(modulus.size());
+    CHECK(exp.begin(base.data(), base.size(), short_exponent.data(), short_exponent.size(), modulus.data(),
+                    modulus.size()));
+    CHECK_EQ(run(exp), steps);
+    exp.getResult(padded_result.data(), padded_result.size());
+
+    std::vector<uint8_t> stripped_result(modulus.size());
+    CHECK(exp.begin(base.data(), base.size(), short_exponent.data() + 16, short_exponent.size() - 16, modulus.data(),
+                    modulus.size()));
+    CHECK_EQ(run(exp), steps);
+    exp.getResult(stripped_result.data(), stripped_result.size());
+    CHECK(padded_result == stripped_result);
+
+    const std::vector<uint8_t> small = {0x01, 0x00, 0x01};
+    std::vector<uint8_t> secret_result(modulus.size());
+    CHECK(exp.begin(base.data(), base.size(), small.data(), small.size(), modulus.data(), modulus.size()));
+    CHECK_EQ(run(exp), steps);
+    exp.getResult(secret_result.data(), secret_result.size());
+
+    std::vector<uint8_t> public_result(modulus.size());
+    CHECK(exp.beginPublic(base.data(), base.size(), small.data(), small.size(), modulus.data(), modulus.size()));
+    CHECK(run(exp) < steps);
+    exp.getResult(public_result.data(), public_result.size());
+    CHECK(secret_result == public_result);
+}
+
+void testInvalid() {
+    const std::vector<uint8_t> odd = {0x00, 0x01, 0x03};
+    const std::vector<uint8_t> even = {0x01, 0x02};
+    const std::vector<uint8_t> zero = {0x00, 0x00};
+    const std::vector<uint8_t> too_long(ModExp::MAX_LIMBS * 4 + 1, 0xFF);
+    const std::vector<uint8_t> five(5, 0xFF);
+
+    ModExp exp;
+    CHECK(exp.begin(odd.data(), odd.size(), odd.data(), odd.size(), odd.data(), odd.size()));
+    CHECK(!exp.begin(odd.data(), odd.size(), odd.data(), odd.size(), even.data(), even.size()));
+    CHECK(!exp.begin(odd.data(), odd.size(), odd.data(), odd.size(), zero.data(), zero.size()));
+    CHECK(!exp.begin(odd.data(), odd.size(), odd.data(), odd.size(), too_long.data(), too_long.size()));
+    CHECK(!exp.begin(odd.data(), odd.size(), too_long.data(), too_long.size(), odd.data(), odd.size()));
+    CHECK(exp.beginPublic(odd.data(), odd.size(), five.data(), five.size(), odd.data(), odd.size()));
+    CHECK(!exp.beginPublic(odd.data(), odd.size(), too_long.data(), too_long.size(), odd.data(), odd.size()));
+
+    // Twice the modulus length in whole limbs.
+    const std::vector<uint8_t> base(8, 0xFF);
+    CHECK(exp.begin(base.data(), base.size(), odd.data(), odd.size(), odd.data(), odd.size()));
+    const std::vector<uint8_t> long_base(9, 0xFF);
+    CHECK(!exp.begin(long_base.data(), long_base.size(), odd.data(), odd.size(), odd.data(), odd.size()));
+    CHECK(!exp.beginMultiply(odd.data(), odd.size(), five.data(), five.size(), odd.data(), odd.size()));
+
+    CHECK(!exp.done());
+    CHECK(!exp.step());
+}
+
+} // namespace
+
+int main() {
+    testVectors();
+    testSmall();
+    testRestart();
+    testConstantSteps();
+    testInvalid();
+
+    return Divacon::Test::result();
+}
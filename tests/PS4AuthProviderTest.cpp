@@ -0,0 +1,117 @@
+#include "utils/PS4AuthProvider.h"
+
+#include "Check.h"
+#include "PS4AuthConfiguration.h"
+
+#include "mbedtls/pk.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/sha256.h"
+#include "pico/rand.h"
+#include "pico/time.h"
+
+#include <cstring>
+#include <stdint.h>
+
+using Divacon::Utils::PS4AuthProvider;
+
+namespace {
+
+// Same byte order as the provider's random source.
+int rng(void *, unsigned char *p, size_t len) {
+    uint64_t rand = 0;
+    for (size_t idx = 0; idx < len; ++idx) {
+        if (idx % sizeof(rand) == 0) {
+            rand = get_rand_64();
+        }
+        p[idx] = static_cast<uint8_t>(rand >> ((idx % sizeof(rand)) * 8));
+    }
+    return 0;
+}
+
+PS4AuthProvider::Signature makeChallenge(uint8_t seed) {
+    PS4AuthProvider::Signature challenge;
+    for (size_t idx = 0; idx < challenge.size(); ++idx) {
+        challenge[idx] = static_cast<uint8_t>(seed * 31 + idx * 7);
+    }
+    return challenge;
+}
+
+// The signature of the previous, blocking implementation.
+PS4AuthProvider::Signature signWithMbedtls(const PS4AuthProvider::Signature &challenge) {
+    const char *key_pem = Divacon::Config::PS4Auth::config.key_pem;
+
+    mbedtls_pk_context pk_context;
+    mbedtls_pk_init(&pk_context);
+    CHECK_EQ(mbedtls_pk_parse_key(&pk_context, reinterpret_cast<const unsigned char *>(key_pem),
+                                  strlen(key_pem) + 1, nullptr, 0),
+             0);
+
+    const auto rsa_context = mbedtls_pk_rsa(pk_context);
+    mbedtls_rsa_set_padding(rsa_context, MBEDTLS_RSA_PKCS_V21, MBEDTLS_MD_SHA256);
+
+    uint8_t hash[32];
+    CHECK_EQ(mbedtls_sha256_ret(challenge.data(), challenge.size(), hash, 0), 0);
+
+    PS4AuthProvider::Signature signature = {};
+    CHECK_EQ(mbedtls_rsa_rsassa_pss_sign(rsa_context, rng, nullptr, MBEDTLS_RSA_PRIVATE, MBEDTLS_MD_SHA256, 32, hash,
+                                         signature.data()),
+             0);
+
+    mbedtls_pk_free(&pk_context);
+
+    return signature;
+}
+
+void testMatchesMbedtls() {
+    static PS4AuthProvider provider;
+
+    for (uint8_t seed = 0; seed < 4; ++seed) {
+        const auto challenge = makeChallenge(seed);
+
+        Divacon::Test::randState() = seed;
+        CHECK(provider.begin(challenge));
+        CHECK(!provider.getSignature());
+
+        size_t steps = 1;
+        while (!provider.step(1000) && steps < 100000) {
+            ++steps;
+        }
+        CHECK(steps > 1);
+
+        Divacon::Test::randState() = seed;
+        const auto expected = signWithMbedtls(challenge);
+
+        const auto signature = provider.getSignature();
+        CHECK(signature.has_value());
+        CHECK(signature == expected);
+    }
+}
+
+// A new challenge abandons the one in progress.
+void testRestart() {
+    static PS4AuthProvider provider;
+    const auto superseded = makeChallenge(10);
+    const auto challenge = makeChallenge(11);
+
+    CHECK(provider.begin(superseded));
+    for (size_t step = 0; step < 20; ++step) {
+        provider.step(1000);
+    }
+
+    Divacon::Test::randState() = 11;
+    CHECK(provider.begin(challenge));
+    while (!provider.step(1000)) {
+    }
+
+    Divacon::Test::randState() = 11;
+    CHECK(provider.getSignature() == signWithMbedtls(challenge));
+}
+
+} // namespace
+
+int main() {
+    testMatchesMbedtls();
+    testRestart();
+
+    return Divacon::Test::result();
+}
@@ -0,0 +1,178 @@
+#include "utils/Scheduler.h"
+
+#include "Check.h"
+
+#include <stdint.h>
+#include <vector>
+
+using Divacon::Utils::Scheduler;
+
+namespace {
+
+uint32_t fake_now_us = 0;
+
+uint32_t fakeClock() { return fake_now_us; }
+
+void testPeriodicRelease() {
+    fake_now_us = 0;
+    Scheduler scheduler(fakeClock);
+
+    uint32_t runs = 0;
+    scheduler.addTask({"periodic", 1000, 1000, 0}, [&](uint32_t) { runs++; });
+
+    // Released right away, then once per period.
+    CHECK(scheduler.runNext());
+    CHECK(!scheduler.runNext());
+    CHECK_EQ(runs, 1);
+
+    fake_now_us = 400;
+    CHECK_EQ(scheduler.getIdleTime(), 600);
+    CHECK(!scheduler.runNext());
+
+    fake_now_us = 1000;
+    CHECK_EQ(scheduler.getIdleTime(), 0);
+    CHECK(scheduler.runNext());
+    CHECK_EQ(runs, 2);
+    CHECK_EQ(scheduler.getStats(0).misses, 0);
+}
+
+void testEarliestDeadlineFirst() {
+    fake_now_us = 0;
+    Scheduler scheduler(fakeClock);
+
+    std::vector<int> order;
+    const auto late = scheduler.addTask({"late", 0, 5000, 9}, [&](uint32_t) { order.push_back(0); });
+    const auto early = scheduler.addTask({"early", 0, 1000, 0}, [&](uint32_t) { order.push_back(1); });
+    const auto tie_low = scheduler.addTask({"tie low", 0, 3000, 1}, [&](uint32_t) { order.push_back(2); });
+    const auto tie_high = scheduler.addTask({"tie high", 0, 3000, 2}, [&](uint32_t) { order.push_back(3); });
+
+    scheduler.trigger(late);
+    scheduler.trigger(tie_low);
+    scheduler.trigger(tie_high);
+    scheduler.trigger(early);
+
+    while (scheduler.runNext()) {
+    }
+
+    CHECK_EQ(order.size(), 4);
+    if (order.size() == 4) {
+        CHECK_EQ(order[0], 1);
+        CHECK_EQ(order[1], 3);
+        CHECK_EQ(order[2], 2);
+        CHECK_EQ(order[3], 0);
+    }
+}
+
+void testTriggerKeepsDeadline() {
+    fake_now_us = 0;
+    Scheduler scheduler(fakeClock);
+
+    std::vector<int> order;
+    const auto first = scheduler.addTask({"first", 0, 1000, 0}, [&](uint32_t) { order.push_back(0); });
+    const auto second = scheduler.addTask({"second", 0, 1000, 0}, [&](uint32_t) { order.push_back(1); });
+
+    scheduler.trigger(first);
+    fake_now_us = 500;
+    scheduler.trigger(second);
+    // Triggering again doesn't move the deadline of `first` behind `second`.
+    scheduler.trigger(first);
+
+    while (scheduler.runNext()) {
+    }
+
+    CHECK_EQ(order.size(), 2);
+    if (order.size() == 2) {
+        CHECK_EQ(order[0], 0);
+        CHECK_EQ(order[1], 1);
+    }
+}
+
+void testLateReleasesDontBurst() {
+    fake_now_us = 0;
+    Scheduler scheduler(fakeClock);
+
+    uint32_t runs = 0;
+    scheduler.addTask({"periodic", 1000, 1000, 0}, [&](uint32_t) { runs++; });
+    scheduler.runNext();
+
+    // The task runs once for the release at 1000, which finishes past its deadline. The releases at 2000 and 3000
+    // are skipped, all three count as misses.
+    fake_now_us = 3500;
+    CHECK(scheduler.runNext());
+    CHECK(!scheduler.runNext());
+    CHECK_EQ(runs, 2);
+    CHECK_EQ(scheduler.getStats(0).misses, 3);
+    CHECK_EQ(scheduler.getStats(0).max_latency_us, 2500);
+
+    // The release grid is kept.
+    CHECK_EQ(scheduler.getIdleTime(), 500);
+}
+
+void testDeadlineMissAndRuntime() {
+    fake_now_us = 0;
+    Scheduler scheduler(fakeClock);
+
+    const auto slow = scheduler.addTask({"slow", 0, 1000, 0}, [&](uint32_t) { fake_now_us += 1500; });
+
+    scheduler.trigger(slow);
+    CHECK(scheduler.runNext());
+
+    const auto &stats = scheduler.getStats(slow);
+    CHECK_EQ(stats.runs, 1);
+    CHECK_EQ(stats.misses, 1);
+    CHECK_EQ(stats.max_runtime_us, 1500);
+    CHECK_EQ(stats.total_runtime_us, 1500);
+
+    scheduler.resetStats();
+    CHECK_EQ(scheduler.getStats(slow).runs, 0);
+}
+
+void testClockWrap() {
+    fake_now_us = UINT32_MAX - 500;
+    Scheduler scheduler(fakeClock);
+
+    uint32_t runs = 0;
+    scheduler.addTask({"periodic", 1000, 1000, 0}, [&](uint32_t) { runs++; });
+    scheduler.runNext();
+
+    fake_now_us += 600;
+    CHECK(!scheduler.runNext());
+    CHECK_EQ(scheduler.getIdleTime(), 400);
+
+    fake_now_us += 400;
+    CHECK(scheduler.runNext());
+    CHECK_EQ(runs, 2);
+    CHECK_EQ(scheduler.getStats(0).misses, 0);
+}
+
+void testCapacity() {
+    fake_now_us = 0;
+    Scheduler scheduler(fakeClock);
+
+    for (size_t idx = 0; idx < Scheduler::MAX_TASKS; ++idx) {
+        CHECK_EQ(scheduler.addTask({"task", 0, 1000, 0}, [](uint32_t) {}), idx);
+    }
+
+    uint32_t runs = 0;
+    const auto overflow = scheduler.addTask({"overflow", 0, 1000, 0}, [&](uint32_t) { runs++; });
+    CHECK_EQ(overflow, Scheduler::INVALID_TASK);
+    CHECK_EQ(scheduler.getTaskCount(), Scheduler::MAX_TASKS);
+
+    scheduler.trigger(overflow);
+    CHECK(!scheduler.runNext());
+    CHECK_EQ(runs, 0);
+}
+
+} // namespace
+
+int main() {
+    testPeriodicRelease();
+    testEarliestDeadlineFirst();
+    testTriggerKeepsDeadline();
+    testLateReleasesDontBurst();
+    testDeadlineMissAndRuntime();
+    testClockWrap();
+    testCapacity();
+
+    return Divacon::Test::result();
+}
@@ -0,0 +1,291 @@
+#include "peripherals/TouchSliderLeds.h"
+#include "utils/Scheduler.h"
+
+#include "Check.h"
+#include "LedTestConfig.h"
+
+#include "pio_ws2812/ws2812.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+
+using Divacon::Peripherals::TouchSliderLeds;
+using Color = TouchSliderLeds::Config::Color;
+
+namespace {
+
+const size_t SEGMENT_COUNT = Divacon::Utils::LedAnimator::SEGMENT_COUNT;
+const uint32_t FRAME_INTERVAL_US = Divacon::Test::LED_FRAME_INTERVAL_US;
+
+using Strip = std::array<uint32_t, SEGMENT_COUNT * TouchSliderLeds::MAX_LEDS_PER_SEGMENT>;
+
+TouchSliderLeds::Config makeConfig(uint16_t leds_per_segment) {
+    auto config = Divacon::Test::ledTestConfig();
+    config.leds_per_segment = leds_per_segment;
+    return config;
+}
+
+// The float color math the slider LEDs used before fixed point, for the static idle and plain touched modes.
+struct FloatReference {
+    uint32_t blend_steps = 0;
+    uint8_t blend_percent = 100;
+
+    static Color dim(const Color &color, float factor) {
+        return {(uint8_t)((float)color.r * factor), (uint8_t)((float)color.g * factor),
+                (uint8_t)((float)color.b * factor)};
+    }
+
+    static uint32_t toPixel(const Color &color, float brightness_factor) {
+        return ws2812_rgb_to_u32pixel(color.r * brightness_factor, color.g * brightness_factor,
+                                      color.b * brightness_factor);
+    }
+
+    // Like before, the math is done for every LED.
+    void render(uint32_t *leds, uint16_t leds_per_segment, const Color &idle_color, const Color &touched_color,
+                uint32_t touched, uint8_t brightness, uint32_t steps) {
+        blend_steps += steps;
+        const uint32_t blend_advance = blend_steps / 128;
+        blend_steps %= 128;
+        if (touched) {
+            blend_percent = blend_advance > blend_percent ? 0 : blend_percent - blend_advance;
+        } else {
+            blend_percent = blend_advance + blend_percent > 100 ? 100 : blend_percent + blend_advance;
+        }
+
+        const float brightness_factor = (float)brightness / 255.;
+        const float blend_factor = (float)blend_percent / 100.;
+
+        for (size_t led = 0; led < SEGMENT_COUNT * leds_per_segment; ++led) {
+            const size_t segment = led / leds_per_segment;
+            const Color dimmed = dim(idle_color, blend_factor);
+            const Color touched_segment =
+                (touched & (0x80000000u >> segment)) ? touched_color : Color{0x00, 0x00, 0x00};
+            const Color blended = {std::max(dimmed.r, touched_segment.r), std::max(dimmed.g, touched_segment.g),
+                                   std::max(dimmed.b, touched_segment.b)};
+            leds[led] = toPixel(blended, brightness_factor);
+        }
+    }
+
+    static Strip renderRaw(const TouchSliderLeds::RawFrameMessage &frame, uint16_t leds_per_segment,
+                           uint8_t brightness) {
+        Strip leds;
+        for (size_t led = 0; led < SEGMENT_COUNT * leds_per_segment; ++led) {
+            const size_t segment = led / leds_per_segment;
+            const uint8_t *grb = &frame.grb[(SEGMENT_COUNT - 1 - segment) * 3];
+            const Color color = {grb[1], grb[0], grb[2]};
+
+            const uint8_t color_max = std::max(color.r, std::max(color.g, color.b));
+            if (color_max > brightness) {
+                leds[led] = toPixel(dim(color, (float)brightness / (float)color_max), 1.0f);
+            } else {
+                leds[led] = ws2812_rgb_to_u32pixel(color.r, color.g, color.b);
+            }
+        }
+        return leds;
+    }
+};
+
+struct Random {
+    uint32_t state;
+
+    uint32_t next() {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    }
+};
+
+// Largest difference of a channel between the sent frame and the expected one.
+uint32_t compareSentFrame(const Strip &expected, uint16_t leds_per_segment) {
+    const auto &strip = Divacon::Test::ws2812();
+    CHECK_EQ(strip.length, SEGMENT_COUNT * leds_per_segment);
+
+    uint32_t max_difference = 0;
+    for (size_t led = 0; led < strip.length; ++led) {
+        const uint32_t actual = strip.front[led];
+        const uint32_t wanted = expected[led];
+        for (uint32_t shift = 8; shift <= 24; shift += 8) {
+            const int32_t difference = static_cast<int32_t>((actual >> shift) & 0xff) - ((wanted >> shift) & 0xff);
+            max_difference = std::max<uint32_t>(max_difference, std::abs(difference));
+        }
+    }
+    return max_difference;
+}
+
+// Animation frames against the float math, with touches, brightness and idle colors changing on the way.
+void testGoldenFrames(uint16_t leds_per_segment) {
+    auto config = makeConfig(leds_per_segment);
+    TouchSliderLeds leds(config);
+    FloatReference reference;
+    Random random = {leds_per_segment};
+
+    uint32_t now_us = 0;
+    uint32_t touched = 0;
+    uint32_t max_difference = 0;
+    for (size_t frame = 0; frame < 2000; ++frame) {
+        if (frame % 7 == 0) {
+            touched = (random.next() % 3 == 0) ? 0 : random.next();
+            leds.setTouched(touched);
+        }
+        if (frame % 50 == 0) {
+            config.brightness = random.next();
+            leds.setBrightness(config.brightness);
+        }
+        if (frame % 90 == 0) {
+            config.idle_color = {static_cast<uint8_t>(random.next()), static_cast<uint8_t>(random.next()),
+                                 static_cast<uint8_t>(random.next())};
+            leds.setIdleColor(config.idle_color);
+        }
+
+        leds.update(now_us);
+        Strip expected;
+        reference.render(expected.data(), leds_per_segment, config.idle_color, config.touched_color, touched,
+                         config.brightness, FRAME_INTERVAL_US * config.animation_speed / 1000);
+        max_difference = std::max(max_difference, compareSentFrame(expected, leds_per_segment));
+
+        now_us += FRAME_INTERVAL_US;
+    }
+
+    CHECK(max_difference <= 1);
+}
+
+void testGoldenRawFrames(uint16_t leds_per_segment) {
+    auto config = makeConfig(leds_per_segment);
+    TouchSliderLeds leds(config);
+    Random random = {leds_per_segment * 3u};
+
+    uint32_t max_difference = 0;
+    for (size_t frame = 0; frame < 2000; ++frame) {
+        if (frame % 50 == 0) {
+            config.brightness = random.next();
+            leds.setBrightness(config.brightness);
+        }
+
+        TouchSliderLeds::RawFrameMessage message = {};
+        for (auto &value : message.grb) {
+            value = random.next() >> 24;
+        }
+
+        leds.update(message);
+        max_difference = std::max(
+            max_difference, compareSentFrame(FloatReference::renderRaw(message, leds_per_segment, config.brightness),
+                                             leds_per_segment));
+    }
+
+    CHECK(max_difference <= 1);
+}
+
+uint32_t fake_now_us = 0;
+
+uint32_t fakeClock() { return fake_now_us; }
+
+struct PacingResult {
+    uint32_t paced;   // Frames rendered on their slot
+    uint32_t dropped; // Slots missed while the update was late
+    uint32_t slots;   // Frame slots which passed in total
+    uint32_t max_jitter_us;
+};
+
+// The core1 tasks next to the LEDs, running on the scheduler with a fake clock. Each task advances the clock by its
+// runtime, the auth task keeps signing in slices the whole time.
+PacingResult simulateCore1(uint16_t target_fps, uint32_t display_runtime_us, uint32_t auth_slice_runtime_us) {
+    const uint32_t duration_us = 10000000;
+
+    fake_now_us = 0;
+    Divacon::Utils::Scheduler scheduler(fakeClock);
+
+    auto config = makeConfig(1);
+    config.target_fps = target_fps;
+    TouchSliderLeds leds(config);
+
+    const uint32_t frame_interval_us = leds.getFrameInterval();
+    scheduler.addTask({"leds", frame_interval_us, frame_interval_us, 2}, [&](uint32_t now_us) {
+        leds.update(now_us);
+        fake_now_us += 150;
+    });
+    Divacon::Utils::Scheduler::TaskId auth_task = 0;
+    auth_task = scheduler.addTask({"auth", 0, 100000, 0}, [&](uint32_t) {
+        fake_now_us += auth_slice_runtime_us;
+        scheduler.trigger(auth_task);
+    });
+    scheduler.addTask({"touch", 1000, 1000, 4}, [&](uint32_t) { fake_now_us += 40; });
+    scheduler.addTask({"display", 20000, 20000, 1}, [&](uint32_t) { fake_now_us += display_runtime_us; });
+    scheduler.trigger(auth_task);
+
+    while (fake_now_us < duration_us) {
+        if (!scheduler.runNext()) {
+            fake_now_us += std::max<uint32_t>(scheduler.getIdleTime(), 1);
+        }
+    }
+
+    return {leds.getFrameTime().count, leds.getFrameStats().dropped, duration_us / frame_interval_us,
+            leds.getFrameJitter().max_us};
+}
+
+// Frames may be rendered up to half an interval off their slot. With the display drawing while its previous frame is
+// still sent by DMA, no core1 task runs that long at 120 fps, the draw time here is well above the real one.
+void testPacingWithCore1Tasks() {
+    const auto result = simulateCore1(120, 2500, 1500);
+    CHECK_EQ(result.dropped, 0u);
+    CHECK(result.paced >= result.slots);
+    CHECK(result.max_jitter_us < 1000000 / 120 / 2);
+}
+
+// A display flush blocking for 10 ms every 20 ms, like before it was sent by DMA, drops a frame every time. Each slot
+// is either rendered or counted as dropped.
+void testPacingCountsDroppedFrames() {
+    const auto result = simulateCore1(120, 10000, 1500);
+    CHECK(result.dropped >= 10000000 / 20000 / 2);
+    CHECK(result.paced + result.dropped >= result.slots);
+    CHECK(result.paced + result.dropped <= result.slots + 1);
+}
+
+// Host timings only, the host has an FPU while the RP2040 runs every float operation in software. The float path did
+// 6 multiplies and 12 conversions per LED, those are counted as well. On the device the "leds" task runtime in the
+// debug telemetry gives the cost per frame.
+void benchmark(uint16_t leds_per_segment) {
+    const size_t frames = 20000;
+    using Clock = std::chrono::steady_clock;
+
+    auto config = makeConfig(leds_per_segment);
+    TouchSliderLeds leds(config);
+
+    // Touches change on every frame, so none is skipped as unchanged.
+    auto start = Clock::now();
+    for (size_t frame = 0; frame < frames; ++frame) {
+        leds.setTouched(frame & 1 ? 0xF0F0F0F0 : 0x0F0F0F0F);
+        leds.update(frame * FRAME_INTERVAL_US);
+    }
+    const auto fixed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+    FloatReference reference;
+    Strip strip;
+    start = Clock::now();
+    for (size_t frame = 0; frame < frames; ++frame) {
+        reference.render(strip.data(), leds_per_segment, config.idle_color, config.touched_color,
+                         frame & 1 ? 0xF0F0F0F0 : 0x0F0F0F0F, config.brightness, config.animation_speed);
+        asm volatile("" : : "r"(strip.data()) : "memory");
+    }
+    const auto float_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+    printf("%u LEDs per segment: fixed point %lld ns per frame, float %lld ns per frame with %u float operations "
+           "(host)\n",
+           leds_per_segment, static_cast<long long>(fixed_ns / frames), static_cast<long long>(float_ns / frames),
+           static_cast<unsigned>(SEGMENT_COUNT * leds_per_segment * 18));
+}
+
+} // namespace
+
+int main() {
+    testPacingWithCore1Tasks();
+    testPacingCountsDroppedFrames();
+
+    for (const uint16_t leds_per_segment : {1, 2, 8}) {
+        testGoldenFrames(leds_per_segment);
+        testGoldenRawFrames(leds_per_segment);
+        benchmark(leds_per_segment);
+    }
+
+    return Divacon::Test::result();
+}
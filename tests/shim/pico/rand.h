@@ -0,0 +1,27 @@
+#ifndef _TESTS_SHIM_PICO_RAND_H_
+#define _TESTS_SHIM_PICO_RAND_H_
+
+#include <stdint.h>
+
+// Deterministic stand-in for the Pico SDK's random numbers, so signatures can be reproduced.
+
+namespace Divacon::Test {
+
+inline uint64_t &randState() {
+    static uint64_t state = 0;
+    return state;
+}
+
+} // namespace Divacon::Test
+
+// splitmix64
+inline uint64_t get_rand_64() {
+    uint64_t value = (Divacon::Test::randState() += 0x9E3779B97F4A7C15ull);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+inline uint32_t get_rand_32() { return static_cast<uint32_t>(get_rand_64()); }
+
+#endif // _TESTS_SHIM_PICO_RAND_H_
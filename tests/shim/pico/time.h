@@ -0,0 +1,21 @@
+#ifndef _TESTS_SHIM_PICO_TIME_H_
+#define _TESTS_SHIM_PICO_TIME_H_
+
+#include <stdint.h>
+
+// Clock which advances by a fixed amount on every read.
+
+namespace Divacon::Test {
+
+const uint32_t TIME_US_PER_READ = 100;
+
+inline uint32_t &timeUs() {
+    static uint32_t now_us = 0;
+    return now_us;
+}
+
+} // namespace Divacon::Test
+
+inline uint32_t time_us_32() { return Divacon::Test::timeUs() += Divacon::Test::TIME_US_PER_READ; }
+
+#endif // _TESTS_SHIM_PICO_TIME_H_
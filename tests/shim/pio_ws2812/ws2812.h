@@ -0,0 +1,62 @@
+#ifndef _TESTS_SHIM_WS2812_H_
+#define _TESTS_SHIM_WS2812_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Stand-in for the PIO driven strips which keeps the frames passed on in memory. There is no gamma correction, so
+// frames can be compared with plain color math.
+
+#define WS2812_MAX_STRIPS 4
+
+namespace Divacon::Test {
+
+struct Ws2812 {
+    uint32_t *front;
+    uint32_t *back;
+    size_t length; // Pixels of all strips
+    uint32_t swaps;
+    bool busy; // Refuses swaps like a strip which is still sending
+};
+
+inline Ws2812 &ws2812() {
+    static Ws2812 state = {};
+    return state;
+}
+
+} // namespace Divacon::Test
+
+inline void ws2812_init_dma(const uint8_t *pins, const size_t *lengths, size_t count, bool is_rgbw, uint32_t *front,
+                            uint32_t *back) {
+    (void)pins;
+    (void)is_rgbw;
+
+    auto &state = Divacon::Test::ws2812();
+    state = {front, back, 0, 0, false};
+    for (size_t idx = 0; idx < count; ++idx) {
+        state.length += lengths[idx];
+    }
+}
+
+inline uint32_t *ws2812_get_back_buffer() { return Divacon::Test::ws2812().back; }
+
+inline bool ws2812_swap_buffers() {
+    auto &state = Divacon::Test::ws2812();
+    if (state.busy) {
+        return false;
+    }
+
+    uint32_t *sent = state.back;
+    state.back = state.front;
+    state.front = sent;
+    state.swaps++;
+    return true;
+}
+
+inline uint32_t ws2812_rgb_to_u32pixel(uint8_t r, uint8_t g, uint8_t b) {
+    return (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 24) | (static_cast<uint32_t>(b) << 8);
+}
+
+inline uint8_t ws2812_gamma_correct(uint8_t value) { return value; }
+
+#endif // _TESTS_SHIM_WS2812_H_